@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sdp_arena.h"
+
+#define ARENA_ALIGN 16
+#define ARENA_CHUNK_SIZE 4096 /* first chunk, later ones double up to max */
+#define ARENA_CHUNK_SIZE_MAX 65536
+
+#define ARENA_ROUND(_size_) (((_size_) + ARENA_ALIGN - 1) & \
+	~((size_t)ARENA_ALIGN - 1))
+
+struct sdp_arena_chunk {
+	struct sdp_arena_chunk *next;
+	size_t size;
+};
+
+struct sdp_arena {
+	struct sdp_arena_chunk *chunk; /* most recent first */
+	struct sdp_arena_chunk *spare; /* released by a reset, for reuse */
+	char *ptr; /* free space in the current chunk */
+	char *end;
+};
+
+#define ARENA_CHUNK_HDR ARENA_ROUND(sizeof(struct sdp_arena_chunk))
+
+static struct sdp_arena_chunk *arena_chunk_alloc(size_t size)
+{
+	struct sdp_arena_chunk *chunk;
+
+	if (!(chunk = (struct sdp_arena_chunk*)malloc(ARENA_CHUNK_HDR + size)))
+		return NULL;
+
+	chunk->next = NULL;
+	chunk->size = size;
+	return chunk;
+}
+
+/* a chunk of at least size bytes, a spare one if there is one large enough,
+ * a new one of alloc_size bytes otherwise */
+static struct sdp_arena_chunk *arena_chunk_get(struct sdp_arena *arena,
+		size_t size, size_t alloc_size)
+{
+	struct sdp_arena_chunk **spare;
+	struct sdp_arena_chunk *chunk;
+
+	for (spare = &arena->spare; *spare && (*spare)->size < size;
+		spare = &(*spare)->next);
+
+	if (!*spare)
+		return arena_chunk_alloc(alloc_size);
+
+	chunk = *spare;
+	*spare = chunk->next;
+	chunk->next = NULL;
+	return chunk;
+}
+
+static void arena_chunk_free(struct sdp_arena_chunk *chunk)
+{
+	while (chunk) {
+		struct sdp_arena_chunk *tmp = chunk;
+
+		chunk = chunk->next;
+		free(tmp);
+	}
+}
+
+struct sdp_arena *sdp_arena_create(void)
+{
+	struct sdp_arena_chunk *chunk;
+	struct sdp_arena *arena;
+
+	if (!(chunk = arena_chunk_alloc(ARENA_CHUNK_SIZE)))
+		return NULL;
+
+	arena = (struct sdp_arena*)((char*)chunk + ARENA_CHUNK_HDR);
+	arena->chunk = chunk;
+	arena->spare = NULL;
+	arena->ptr = (char*)arena + ARENA_ROUND(sizeof(struct sdp_arena));
+	arena->end = (char*)arena + chunk->size;
+	return arena;
+}
+
+void sdp_arena_destroy(struct sdp_arena *arena)
+{
+	arena_chunk_free(arena->spare);
+	/* the arena itself goes with its first chunk, somewhere in the list */
+	arena_chunk_free(arena->chunk);
+}
+
+void sdp_arena_reset(struct sdp_arena *arena, const void *end)
+{
+	struct sdp_arena_chunk *first;
+	char *base;
+
+	first = (struct sdp_arena_chunk*)((char*)arena - ARENA_CHUNK_HDR);
+	base = (char*)first + ARENA_CHUNK_HDR;
+
+	/* chunks of large allocations or merged from another arena need not
+	 * precede the first one */
+	while (arena->chunk) {
+		struct sdp_arena_chunk *chunk = arena->chunk;
+
+		arena->chunk = chunk->next;
+		if (chunk == first)
+			continue;
+
+		chunk->next = arena->spare;
+		arena->spare = chunk;
+	}
+	first->next = NULL;
+	arena->chunk = first;
+
+	arena->ptr = base + ARENA_ROUND((size_t)((const char*)end - base));
+	arena->end = base + first->size;
+}
+
+void sdp_arena_trim(struct sdp_arena *arena)
+{
+	arena_chunk_free(arena->spare);
+	arena->spare = NULL;
+}
+
+void sdp_arena_merge(struct sdp_arena *arena, struct sdp_arena *from)
+{
+	struct sdp_arena_chunk *chunks = from->chunk;
+	struct sdp_arena_chunk *spare = from->spare;
+	struct sdp_arena_chunk **link;
+
+	/* from's chunks, its own first one included, follow the current
+	 * chunk, which allocations carry on from */
+	for (link = &chunks; *link; link = &(*link)->next);
+	*link = arena->chunk->next;
+	arena->chunk->next = chunks;
+
+	for (link = &arena->spare; *link; link = &(*link)->next);
+	*link = spare;
+}
+
+/* align is a power of 2 no larger than ARENA_ALIGN, chunks start aligned
+ * to the latter */
+static void *arena_alloc(struct sdp_arena *arena, size_t size, size_t align)
+{
+	struct sdp_arena_chunk *chunk;
+	size_t chunk_size;
+	char *ptr;
+
+	ptr = (char*)(((uintptr_t)arena->ptr + align - 1) &
+		~((uintptr_t)align - 1));
+	if (size <= (size_t)(arena->end - ptr)) {
+		arena->ptr = ptr + size;
+		memset(ptr, 0, size);
+		return ptr;
+	}
+
+	size = ARENA_ROUND(size);
+	chunk_size = arena->chunk->size < ARENA_CHUNK_SIZE_MAX ?
+		arena->chunk->size << 1 : ARENA_CHUNK_SIZE_MAX;
+
+	/* an allocation larger than a chunk gets one of its own, leaving the
+	 * current chunk in use */
+	if (chunk_size < size) {
+		if (!(chunk = arena_chunk_get(arena, size, size)))
+			return NULL;
+
+		chunk->next = arena->chunk->next;
+		arena->chunk->next = chunk;
+
+		ptr = (char*)chunk + ARENA_CHUNK_HDR;
+		memset(ptr, 0, size);
+		return ptr;
+	}
+
+	if (!(chunk = arena_chunk_get(arena, size, chunk_size)))
+		return NULL;
+
+	chunk->next = arena->chunk;
+	arena->chunk = chunk;
+	arena->ptr = (char*)chunk + ARENA_CHUNK_HDR + size;
+	arena->end = (char*)chunk + ARENA_CHUNK_HDR + chunk->size;
+
+	ptr = (char*)chunk + ARENA_CHUNK_HDR;
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+void *sdp_arena_alloc(struct sdp_arena *arena, size_t size)
+{
+	return arena_alloc(arena, size, ARENA_ALIGN);
+}
+
+char *sdp_arena_strdup(struct sdp_arena *arena, const char *s)
+{
+	size_t len = strlen(s) + 1;
+	char *dup;
+
+	/* strings are packed, with no alignment */
+	if (!(dup = (char*)arena_alloc(arena, len, 1)))
+		return NULL;
+
+	memcpy(dup, s, len);
+	return dup;
+}
+
+size_t sdp_arena_size(const struct sdp_arena *arena)
+{
+	const struct sdp_arena_chunk *lists[] = { arena->chunk, arena->spare };
+	const struct sdp_arena_chunk *chunk;
+	size_t size = 0;
+	size_t i;
+
+	for (i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+		for (chunk = lists[i]; chunk; chunk = chunk->next)
+			size += ARENA_CHUNK_HDR + chunk->size;
+	}
+
+	return size;
+}
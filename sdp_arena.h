@@ -0,0 +1,41 @@
+#ifndef _SDP_ARENA_H_
+#define _SDP_ARENA_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bump allocator
+ *
+ * Allocations are carved out of chunks that only grow in number, and are
+ * all released at once with the arena itself. The arena's own bookkeeping
+ * lives in its first chunk. A reset releases allocations but keeps the
+ * chunks, so that an arena used over and over stops allocating once it has
+ * grown to fit. */
+
+struct sdp_arena;
+
+struct sdp_arena *sdp_arena_create(void);
+void sdp_arena_destroy(struct sdp_arena *arena);
+/* releases every allocation made after end, which lies in the first chunk */
+void sdp_arena_reset(struct sdp_arena *arena, const void *end);
+/* releases the chunks kept by a reset */
+void sdp_arena_trim(struct sdp_arena *arena);
+/* hands the allocations and chunks of from over to arena, from being gone
+ * with them. They are released with arena, or kept for reuse by a reset */
+void sdp_arena_merge(struct sdp_arena *arena, struct sdp_arena *from);
+
+/* zero initialized, NULL on allocation failure */
+void *sdp_arena_alloc(struct sdp_arena *arena, size_t size);
+char *sdp_arena_strdup(struct sdp_arena *arena, const char *s);
+
+/* bytes held by the arena, spare chunks included */
+size_t sdp_arena_size(const struct sdp_arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,6 +2,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#if defined(__linux__)
+#include <arpa/inet.h>
+#endif
 
 #include "sdp_parser.h"
 #include "smpte2110_sdp_parser.h"
@@ -42,6 +45,7 @@ struct pgroup_info {
 
 struct sdp_extractor {
 	struct sdp_session *session;
+	int is_session_borrowed; /* session is not released with extractor */
 
 	int stream_num;
 	enum smpte_2110_pm pm[MAX_STRMS_PER_RING];
@@ -144,6 +148,25 @@ static struct sdp_connection_information *get_connection_information(
 	return NULL;
 }
 
+/* addresses are formatted from their binary form, the session does not
+ * have to keep them as text. Only names are */
+static void extract_addr(enum sdp_ci_addrtype addrtype,
+		struct sdp_addr *addr, char *text, char *buf, size_t size)
+{
+	*buf = 0;
+
+	if (addr->is_name) {
+		if (text)
+			snprintf(buf, size, "%s", text);
+		return;
+	}
+
+	if (!inet_ntop(addrtype == SDP_CI_ADDRTYPE_IPV6 ? AF_INET6 : AF_INET,
+			&addr->u, buf, size)) {
+		*buf = 0;
+	}
+}
+
 static int extract_networking_info(struct sdp_extractor *e)
 {
 	struct sdp_session *session = e->session;
@@ -158,9 +181,12 @@ static int extract_networking_info(struct sdp_extractor *e)
 		source_filter_attr =
 			sdp_media_attr_get(media, SDP_ATTR_SOURCE_FILTER);
 		if (source_filter_attr) {
-			strncpy(e->addr_src[i],
-				source_filter_attr->value.source_filter.spec.src_list.addr,
-				IP_MAX_HDR_LEN);
+			struct sdp_attr_source_filter_spec *spec =
+				&source_filter_attr->value.source_filter.spec;
+
+			extract_addr(spec->addrtype, &spec->src_list.src,
+				spec->src_list.addr, e->addr_src[i],
+				sizeof(e->addr_src[i]));
 		}
 
 		c = get_connection_information(session, media);
@@ -175,7 +201,8 @@ static int extract_networking_info(struct sdp_extractor *e)
 			return -1;
 		}
 
-		strncpy(e->addr_dst[i], c->sdp_ci_addr, IP_MAX_HDR_LEN);
+		extract_addr(c->addrtype, &c->addr, c->sdp_ci_addr,
+			e->addr_dst[i], sizeof(e->addr_dst[i]));
 		e->port_dst[i] = media->m.port;
 	}
 
@@ -367,12 +394,18 @@ static int sdp_parse(struct sdp_extractor *e, void *sdp,
 		return -1;
 	}
 
-	err = sdp_session_parse(e->session, smpte2110_sdp_parse_specific);
+	err = sdp_session_parse(e->session, smpte2110_sdp_parse_specific,
+		NULL);
 	if (err != SDP_PARSE_OK) {
 		sdp_extractor_err("sdp parsing failed");
 		return -1;
 	}
 
+	return 0;
+}
+
+static int sdp_extract(struct sdp_extractor *e)
+{
 	/* extract number of dup sessions */
 	e->stream_num = extract_dup_num(e);
 	if (e->stream_num < 1) {
@@ -536,7 +569,7 @@ void sdp_extractor_uninit(sdp_extractor_t sdp_extractor)
 {
 	struct sdp_extractor *e = (struct sdp_extractor*)sdp_extractor;
 
-	if (e->session)
+	if (e->session && !e->is_session_borrowed)
 		sdp_parser_uninit(e->session);
 	memset(e, 0, sizeof(struct sdp_extractor));
 	free(e);
@@ -550,7 +583,26 @@ sdp_extractor_t sdp_extractor_init(void *sdp, enum sdp_stream_type type)
 	if (!e)
 		return NULL;
 
-	if (sdp_parse(e, sdp, type)) {
+	if (sdp_parse(e, sdp, type) || sdp_extract(e)) {
+		sdp_extractor_uninit((sdp_extractor_t)e);
+		return NULL;
+	}
+
+	return (sdp_extractor_t)e;
+}
+
+sdp_extractor_t sdp_extractor_init_session(struct sdp_session *session)
+{
+	struct sdp_extractor *e;
+
+	e = (struct sdp_extractor*)calloc(1, sizeof(struct sdp_extractor));
+	if (!e)
+		return NULL;
+
+	e->session = session;
+	e->is_session_borrowed = 1;
+
+	if (sdp_extract(e)) {
 		sdp_extractor_uninit((sdp_extractor_t)e);
 		return NULL;
 	}
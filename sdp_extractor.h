@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include "sdp_stream.h"
 
+struct sdp_session;
+
 typedef void *sdp_extractor_t;
 
 char *sdp_extractor_get_session_name(sdp_extractor_t sdp_extractor);
@@ -27,6 +29,11 @@ int sdp_extractor_set_npackets(sdp_extractor_t sdp_extractor, int npackets);
 
 void sdp_extractor_uninit(sdp_extractor_t sdp_extractor);
 sdp_extractor_t sdp_extractor_init(void *sdp, enum sdp_stream_type type);
+/* extract from a session parsed by the caller (with
+ * smpte2110_sdp_parse_specific), who releases it after the extractor.
+ * Addresses are read in their binary form, the session needs not have been
+ * parsed with is_addr_text set */
+sdp_extractor_t sdp_extractor_init_session(struct sdp_session *session);
 
 #endif /* _SDP_EXTRACTOR_H_ */
 
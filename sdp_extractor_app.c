@@ -2,12 +2,15 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#include <errno.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <poll.h>
 
 #include "util.h"
 #include "smpte2110_sdp_parser.h"
 #include "sdp_extractor.h"
+#include "sdp_watcher.h"
 
 #define COPYRIGHT "\u00A9"
 #define C_ITALIC "\033[00;3m"
@@ -45,6 +48,18 @@ static struct {
 		.description_arg = "num",
 		.is_optional = 1,
 	},
+	{
+		.args = {
+			.name = "watch",
+			.has_arg = required_argument,
+			.flag = NULL,
+			.val = 'w',
+		},
+		.description = "Directory of SDPs to follow, reporting changes "
+			"(instead of -s)",
+		.description_arg = "dir",
+		.is_optional = 1,
+	},
 };
 
 static void abort_printf(const char *format, ...)
@@ -184,10 +199,12 @@ static void print_version(void)
 	printf(C_HIGHLIGHT "Version: " C_NORMAL " %s\n", SDP_EXTRACTOR_VERSION);
 }
 
-static void parse_input(int argc, char **argv, char **sdp_path, int *packets)
+static void parse_input(int argc, char **argv, char **sdp_path, int *packets,
+		char **watch_dir)
 {
 	char *__sdp_path = NULL;
 	int __packets = 0;
+	char *__watch_dir = NULL;
 	char *app_name;
 	char *endptr;
 	char *optstring;
@@ -262,6 +279,13 @@ static void parse_input(int argc, char **argv, char **sdp_path, int *packets)
 					"negative integer value: %s", optarg);
 			}
 			break;
+		case 'w':
+			if (__watch_dir) {
+				abort_printf("watch directory previously set "
+					"to: %s", __watch_dir);
+			}
+			__watch_dir = optarg;
+			break;
 		default:
 			usage(app_name);
 			exit(-1);
@@ -273,18 +297,78 @@ static void parse_input(int argc, char **argv, char **sdp_path, int *packets)
 	free(longopts);
 
 	/* validate input */
-	if (!__sdp_path)
+	if (!__sdp_path && !__watch_dir)
 		abort_printf("SDP file not provided");
+	if (__sdp_path && __watch_dir)
+		abort_printf("-s/--sdp and -w/--watch are mutually exclusive");
 
 	/* init parameters and data structures */
 	*sdp_path = __sdp_path;
 	*packets = __packets;
+	*watch_dir = __watch_dir;
+}
+
+static void watch_report(sdp_watcher_t watcher, enum sdp_watcher_event event,
+		struct sdp_watcher_entry *entry, void *ctx)
+{
+	struct code2str events[] = {
+		{ SDP_WATCHER_EVENT_ADDED, "added" },
+		{ SDP_WATCHER_EVENT_CHANGED, "changed" },
+		{ SDP_WATCHER_EVENT_REMOVED, "removed" },
+		{ -1, "Unknown" }
+	};
+	sdp_extractor_t sdp_extractor = entry->extractor;
+	int i;
+
+	printf(C_HIGHLIGHT "%-8s" C_NORMAL " %s", code2str(events, event),
+		entry->name);
+
+	if (event == SDP_WATCHER_EVENT_REMOVED) {
+		printf("\n");
+		return;
+	}
+
+	if (!sdp_extractor) {
+		printf(": %s\n", entry->session ? "unsupported SDP" :
+			C_RED "parse error" C_NORMAL);
+		return;
+	}
+
+	printf(": %s\n", sdp_extractor_get_session_name(sdp_extractor));
+	for (i = 0; i < sdp_extractor_get_stream_num(sdp_extractor); i++) {
+		printf("  stream %d: %s -> %s:%u\n", i,
+			sdp_extractor_get_src_ip(sdp_extractor, i),
+			sdp_extractor_get_dst_ip(sdp_extractor, i),
+			sdp_extractor_get_dst_port(sdp_extractor, i));
+	}
+	fflush(stdout);
+}
+
+static int watch(char *watch_dir)
+{
+	sdp_watcher_t watcher;
+	struct pollfd pfd;
+
+	watcher = sdp_watcher_init(watch_dir, watch_report, NULL);
+	if (!watcher)
+		abort_printf("Cannot watch directory: %s", watch_dir);
+
+	pfd.fd = sdp_watcher_fd(watcher);
+	pfd.events = POLLIN;
+	while (poll(&pfd, 1, -1) != -1 || errno == EINTR) {
+		if (sdp_watcher_process(watcher) == -1)
+			break;
+	}
+
+	sdp_watcher_uninit(watcher);
+	return -1;
 }
 
 int main(int argc, char **argv)
 {
 	char *sdp_path;
 	int npackets;
+	char *watch_dir;
 	sdp_extractor_t sdp_extractor;
 	int stream_num;
 	int i;
@@ -310,7 +394,10 @@ int main(int argc, char **argv)
 
 	dump_header();
 
-	parse_input(argc, argv, &sdp_path, &npackets);
+	parse_input(argc, argv, &sdp_path, &npackets, &watch_dir);
+
+	if (watch_dir)
+		return watch(watch_dir);
 
 	if (dump_sdp(sdp_path))
 		abort_printf("Cannot read SDP: %s", sdp_path);
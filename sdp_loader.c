@@ -0,0 +1,470 @@
+#define _GNU_SOURCE /* O_CLOEXEC */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "sdp_loader.h"
+#include "sdp_pool.h"
+
+#define LOAD_QUEUE_DEPTH 64 /* reads in flight, bounds the open files */
+
+struct sdp_loader {
+	char **paths;
+	struct sdp_load_result *results;
+	parse_attr_specific_t parse_attr_specific;
+	void *ctx; /* of parse_attr_specific */
+};
+
+/* a file being read */
+struct load_file {
+	int fd;
+	char *buf;
+	size_t size;
+	size_t done; /* bytes read so far */
+	struct iovec iov;
+};
+
+static int load_file_open(struct load_file *lf, char *path)
+{
+	struct stat st;
+
+	memset(lf, 0, sizeof(struct load_file));
+
+	if ((lf->fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+		sdperr("cannot open %s", path);
+		return -1;
+	}
+
+	if (fstat(lf->fd, &st) || !S_ISREG(st.st_mode)) {
+		sdperr("not a regular file: %s", path);
+		goto fail;
+	}
+
+	lf->size = st.st_size;
+	if (!(lf->buf = (char*)malloc(lf->size ? lf->size : 1))) {
+		sdperr("memory allocation");
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	close(lf->fd);
+	lf->fd = -1;
+	return -1;
+}
+
+static void load_file_close(struct load_file *lf)
+{
+	if (lf->fd != -1)
+		close(lf->fd);
+	free(lf->buf);
+	lf->fd = -1;
+	lf->buf = NULL;
+}
+
+/* the file is parsed in place, fed straight from the read buffer */
+static void load_file_parse(struct sdp_loader *loader, int i,
+		struct load_file *lf)
+{
+	struct sdp_load_result *result = &loader->results[i];
+	struct sdp_session *session;
+
+	result->session = NULL;
+	result->err = SDP_PARSE_ERROR;
+
+	if (!(session = sdp_parser_init_push(loader->parse_attr_specific,
+			loader->ctx))) {
+		return;
+	}
+
+	sdp_parser_feed(session, lf->buf, lf->done);
+	result->err = sdp_parser_finish(session);
+	if (result->err != SDP_PARSE_OK) {
+		sdp_parser_uninit(session);
+		return;
+	}
+
+	/* only the description is handed out */
+	sdp_session_compact(session);
+	result->session = session;
+}
+
+/* Thread-pooled pread(2) */
+static void load_pread_job(void *ctx, int i)
+{
+	struct sdp_loader *loader = (struct sdp_loader*)ctx;
+	struct load_file lf;
+
+	if (load_file_open(&lf, loader->paths[i]))
+		return;
+
+	while (lf.done < lf.size) {
+		ssize_t ret;
+
+		ret = pread(lf.fd, lf.buf + lf.done, lf.size - lf.done,
+			lf.done);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret == -1) {
+			sdperr("cannot read %s", loader->paths[i]);
+			goto exit;
+		}
+		if (!ret)
+			break; /* file shrunk since it was opened */
+
+		lf.done += ret;
+	}
+
+	close(lf.fd);
+	lf.fd = -1;
+
+	load_file_parse(loader, i, &lf);
+
+exit:
+	load_file_close(&lf);
+}
+
+static void load_pread(struct sdp_loader *loader, int n)
+{
+	sdp_pool_run(0, n, load_pread_job, loader);
+}
+
+/* io_uring */
+struct uring {
+	int fd;
+	unsigned int entries;
+
+	/* submission queue */
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	struct io_uring_sqe *sqes;
+	unsigned int sq_pending; /* prepared, not yet submitted */
+
+	/* completion queue */
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+};
+
+static void uring_exit(struct uring *ring)
+{
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+}
+
+static int uring_init(struct uring *ring, unsigned int entries)
+{
+	struct io_uring_params p;
+	char *sq;
+	char *cq;
+
+	memset(ring, 0, sizeof(struct uring));
+	memset(&p, 0, sizeof(struct io_uring_params));
+
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (ring->fd < 0)
+		return -1;
+
+	ring->entries = p.sq_entries;
+	ring->sq_ring_size = p.sq_off.array +
+		p.sq_entries * sizeof(unsigned int);
+	ring->cq_ring_size = p.cq_off.cqes +
+		p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	/* both rings may share a single mapping */
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_ring_size > ring->sq_ring_size)
+			ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		ring->sq_ring = NULL;
+		goto fail;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_ring = ring->sq_ring;
+	} else {
+		ring->cq_ring = mmap(NULL, ring->cq_ring_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cq_ring == MAP_FAILED) {
+			ring->cq_ring = NULL;
+			goto fail;
+		}
+	}
+
+	ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+		IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = NULL;
+		goto fail;
+	}
+
+	sq = (char*)ring->sq_ring;
+	ring->sq_head = (unsigned int*)(sq + p.sq_off.head);
+	ring->sq_tail = (unsigned int*)(sq + p.sq_off.tail);
+	ring->sq_mask = (unsigned int*)(sq + p.sq_off.ring_mask);
+	ring->sq_array = (unsigned int*)(sq + p.sq_off.array);
+
+	cq = (char*)ring->cq_ring;
+	ring->cq_head = (unsigned int*)(cq + p.cq_off.head);
+	ring->cq_tail = (unsigned int*)(cq + p.cq_off.tail);
+	ring->cq_mask = (unsigned int*)(cq + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+	return 0;
+
+fail:
+	uring_exit(ring);
+	return -1;
+}
+
+/* queue a read of the rest of file i */
+static void uring_prep_read(struct uring *ring, struct load_file *lf, int i)
+{
+	unsigned int tail = *ring->sq_tail;
+	unsigned int idx = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+	lf->iov.iov_base = lf->buf + lf->done;
+	lf->iov.iov_len = lf->size - lf->done;
+
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = lf->fd;
+	sqe->addr = (unsigned long)&lf->iov;
+	sqe->len = 1;
+	sqe->off = lf->done;
+	sqe->user_data = i;
+
+	ring->sq_array[idx] = idx;
+	/* the entry is visible to the kernel before the tail moves */
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ring->sq_pending++;
+}
+
+/* submit the prepared reads and wait for at least one completion */
+static int uring_enter(struct uring *ring, unsigned int wait)
+{
+	int ret;
+
+	do {
+		ret = (int)syscall(__NR_io_uring_enter, ring->fd,
+			ring->sq_pending, wait,
+			wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret < 0)
+		return -1;
+
+	ring->sq_pending -= ret;
+	return 0;
+}
+
+static int load_uring(struct sdp_loader *loader, int n)
+{
+	struct uring ring;
+	struct load_file *files;
+	unsigned int inflight = 0;
+	int next = 0;
+
+	if (!(files = (struct load_file*)calloc(n, sizeof(struct load_file))))
+		return -1;
+
+	if (uring_init(&ring, LOAD_QUEUE_DEPTH)) {
+		free(files);
+		return -1;
+	}
+
+	while (next < n || inflight) {
+		unsigned int head;
+		unsigned int tail;
+
+		/* keep the queue full */
+		while (next < n && inflight < ring.entries) {
+			struct load_file *lf = &files[next];
+
+			if (!load_file_open(lf, loader->paths[next])) {
+				if (lf->size) {
+					uring_prep_read(&ring, lf, next);
+					inflight++;
+				} else {
+					load_file_parse(loader, next, lf);
+					load_file_close(lf);
+				}
+			}
+
+			next++;
+		}
+
+		if (!inflight)
+			continue;
+
+		if (uring_enter(&ring, 1))
+			goto fail;
+
+		head = *ring.cq_head;
+		tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		for ( ; head != tail; head++) {
+			struct io_uring_cqe *cqe;
+			struct load_file *lf;
+			int i;
+
+			cqe = &ring.cqes[head & *ring.cq_mask];
+			i = (int)cqe->user_data;
+			lf = &files[i];
+
+			if (cqe->res < 0) {
+				sdperr("cannot read %s", loader->paths[i]);
+			} else {
+				lf->done += cqe->res;
+
+				/* a short read is resumed where it stopped */
+				if (cqe->res && lf->done < lf->size) {
+					uring_prep_read(&ring, lf, i);
+					continue;
+				}
+
+				load_file_parse(loader, i, lf);
+			}
+
+			load_file_close(lf);
+			inflight--;
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	uring_exit(&ring);
+	free(files);
+	return 0;
+
+fail:
+	/* reads in flight complete into their buffers until the ring is torn
+	 * down, only then are they released */
+	uring_exit(&ring);
+	for (next = 0; next < n; next++) {
+		if (files[next].buf)
+			load_file_close(&files[next]);
+	}
+	free(files);
+	return -1;
+}
+
+int sdp_load(char **paths, int n, parse_attr_specific_t parse_attr_specific,
+		void *ctx, struct sdp_load_result *results, unsigned int flags)
+{
+	struct sdp_loader loader;
+	int loaded = 0;
+	int i;
+
+	if (n <= 0)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		results[i].session = NULL;
+		results[i].err = SDP_PARSE_ERROR;
+	}
+
+	loader.paths = paths;
+	loader.results = results;
+	loader.parse_attr_specific = parse_attr_specific;
+	loader.ctx = ctx;
+
+	if ((flags & SDP_LOAD_PREAD) || load_uring(&loader, n)) {
+		/* files already parsed through io_uring are loaded again */
+		for (i = 0; i < n; i++) {
+			if (results[i].session)
+				sdp_parser_uninit(results[i].session);
+			results[i].session = NULL;
+			results[i].err = SDP_PARSE_ERROR;
+		}
+
+		load_pread(&loader, n);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (results[i].session)
+			loaded++;
+	}
+
+	return loaded;
+}
+
+/* a batch of descriptions in memory */
+struct sdp_batch {
+	char **inputs;
+	const struct sdp_profile *profile;
+	struct sdp_load_result *results;
+};
+
+static void batch_parse_job(void *ctx, int i)
+{
+	struct sdp_batch *batch = (struct sdp_batch*)ctx;
+	struct sdp_load_result *result = &batch->results[i];
+	struct sdp_session *session;
+
+	result->session = NULL;
+	result->err = SDP_PARSE_ERROR;
+
+	if (!(session = sdp_parser_init(SDP_STREAM_TYPE_CHAR,
+			batch->inputs[i]))) {
+		return;
+	}
+
+	result->err = sdp_session_parse_profile(session, batch->profile);
+	if (result->err != SDP_PARSE_OK) {
+		sdp_parser_uninit(session);
+		return;
+	}
+
+	sdp_session_compact(session);
+	result->session = session;
+}
+
+int sdp_parse_batch(char **inputs, int n, const struct sdp_profile *profile,
+		struct sdp_load_result *results)
+{
+	struct sdp_batch batch = { inputs, profile, results };
+	int parsed = 0;
+	int i;
+
+	if (n <= 0)
+		return 0;
+
+	sdp_pool_run(0, n, batch_parse_job, &batch);
+
+	for (i = 0; i < n; i++) {
+		if (results[i].session)
+			parsed++;
+	}
+
+	return parsed;
+}
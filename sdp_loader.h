@@ -0,0 +1,64 @@
+#ifndef _SDP_LOADER_H_
+#define _SDP_LOADER_H_
+
+#include "sdp_parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bulk loader
+ *
+ * Reads many SDP files at once and parses each one as soon as its read
+ * completes. Reads are submitted through io_uring, keeping a bounded number
+ * of them in flight. Where io_uring is not available reads are spread over
+ * a pool of threads issuing pread(2). Descriptions already in memory are
+ * parsed over the same pool. */
+
+/* sdp_load() flags */
+#define SDP_LOAD_PREAD (1 << 0) /* read through the thread pool only */
+
+struct sdp_load_result {
+	enum sdp_parse_err err; /* SDP_PARSE_ERROR if the file was not read */
+	struct sdp_session *session; /* NULL unless parsed successfully */
+};
+
+/** Load and parse SDP files
+ * @param paths      files to load.
+ * @param n          number of files.
+ * @param parse_attr_specific Specific attribute parser passed on to the
+ *                   parser. Files are parsed concurrently, the parser is
+ *                   called from several threads at once.
+ * @param ctx        passed on to parse_attr_specific.
+ * @param results    n results, results[i] corresponding to paths[i]. Each
+ *                   session is compacted, see sdp_session_compact(), and
+ *                   released by the caller with sdp_parser_uninit().
+ * @param flags      SDP_LOAD_* flags.
+ *
+ * @return the number of sessions parsed successfully.
+ */
+int sdp_load(char **paths, int n, parse_attr_specific_t parse_attr_specific,
+		void *ctx, struct sdp_load_result *results, unsigned int flags);
+
+/** Parse many descriptions held in memory
+ * The descriptions are spread over a pool of threads, one per online
+ * processor, which steal from each other's share as they run out.
+ *
+ * @param inputs     null-terminated descriptions, as for
+ *                   SDP_STREAM_TYPE_CHAR.
+ * @param n          number of descriptions.
+ * @param profile    attribute parsers, shared by the threads, NULL for none.
+ * @param results    n results, results[i] corresponding to inputs[i]. Each
+ *                   session is compacted, see sdp_session_compact(), and
+ *                   released by the caller with sdp_parser_uninit().
+ *
+ * @return the number of sessions parsed successfully.
+ */
+int sdp_parse_batch(char **inputs, int n, const struct sdp_profile *profile,
+		struct sdp_load_result *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
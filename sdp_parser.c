@@ -14,7 +14,15 @@
 #endif
 
 #include "util.h"
+#include "sdp_arena.h"
+#include "sdp_scan.h"
 #include "sdp_parser.h"
+#include "sdp_profile.h"
+#if defined(__linux__)
+#include <unistd.h>
+#include "sdp_pool.h"
+#define SDP_PARSE_PARALLEL
+#endif
 
 #ifndef NOT_IN_USE
 #define NOT_IN_USE(a) ((void)(a))
@@ -44,31 +52,105 @@
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
 #endif
 
-/* returns an SDP line with no trailing whitespaces or line delimiters */
-static size_t sdp_getline(char **line, size_t *len, sdp_stream_t sdp)
+#define SDP_OUT_LINE_MAX 512 /* diagnostics are truncated to fit */
+
+#define SDP_PARSE_RUN_MEDIA_MIN 32 /* media blocks worth a parallel run */
+#define SDP_PARSE_BLOCK 65536 /* bytes of input indexed at once */
+
+#define FNV1A_OFFSET 14695981039346656037ULL
+#define FNV1A_PRIME 1099511628211ULL
+
+/* sdp parse state: the section of the description the next line belongs to.
+ * Lines are fed to the parser one at a time so that parsing can resume
+ * wherever the input left off */
+enum sdp_parse_state {
+	SDP_PARSE_STATE_VERSION, /* v= */
+	SDP_PARSE_STATE_ORIGIN, /* o=, up to s= */
+	SDP_PARSE_STATE_SESSION_INFO, /* i= u= e= p=, up to c= */
+	SDP_PARSE_STATE_SESSION_TIME, /* b= t= r= z= k= */
+	SDP_PARSE_STATE_SESSION_ATTR, /* a= */
+	SDP_PARSE_STATE_MEDIA_SKIP, /* non supported m= block */
+	SDP_PARSE_STATE_MEDIA_INFO, /* i=, up to c= */
+	SDP_PARSE_STATE_MEDIA_BANDWIDTH, /* b= k= */
+	SDP_PARSE_STATE_MEDIA_ATTR, /* a= */
+};
+
+struct sdp_parser {
+	enum sdp_parse_state state;
+	enum sdp_parse_err err; /* once in error, further input is ignored */
+	parse_attr_specific_t parse_attr_specific;
+	void *parse_ctx; /* of parse_attr_specific */
+	const struct sdp_profile *profile; /* instead of parse_attr_specific */
+	struct sdp_session *session;
+	struct sdp_media *media; /* media block being parsed */
+	struct sdp_attr **attr; /* tail of the attribute list being parsed */
+	struct sdp_attr_index *a_index; /* of the level being parsed */
+	struct sdp_attr *a_tail[SDP_ATTR_TYPE_COUNT]; /* last of each type */
+	int is_line_required; /* v= and s= must be followed by more fields */
+	int is_eos; /* an empty line ends the description */
+	int is_fed; /* push mode, until finished */
+	size_t media_flat_size; /* capacities of the flat arrays */
+	size_t attr_flat_size;
+
+	/* buffer the input is copied to a block at a time, as parsing
+	 * tokenizes in place. It only grows and outlives the parse for the
+	 * session to be reused, so it is reallocated only when meeting a line
+	 * longer than a block */
+	char *buf;
+	size_t size;
+	size_t partial; /* length of a line split between blocks */
+
+	/* structural index of the block, sized along with buf */
+	uint64_t *bits;
+	struct sdp_scan scan;
+};
+
+/* the line buffer is kept */
+static void sdp_parser_setup(struct sdp_parser *p,
+		struct sdp_session *session,
+		parse_attr_specific_t parse_attr_specific, void *parse_ctx,
+		const struct sdp_profile *profile)
+{
+	char *buf = p->buf;
+	size_t size = p->size;
+	uint64_t *bits = p->bits;
+
+	memset(p, 0, sizeof(struct sdp_parser));
+	p->buf = buf;
+	p->size = size;
+	p->bits = bits;
+	p->session = session;
+	p->state = SDP_PARSE_STATE_VERSION;
+	p->err = SDP_PARSE_OK;
+	p->parse_attr_specific = parse_attr_specific;
+	p->parse_ctx = parse_ctx;
+	p->profile = profile;
+}
+
+static int sdp_parser_reserve(struct sdp_parser *p, size_t size)
 {
-	ssize_t ret;
+	char *ptr;
+	uint64_t *bits;
 
-	ret = sdp_stream_getline(line, len, sdp);
-	if (ret <= 0) {
-		free(*line);
-		*line = NULL;
-		*len = 0;
+	if (size <= p->size)
 		return 0;
-	}
 
-	while (ret && IS_WHITESPACE_DELIM((*line)[ret-1]))
-		ret--;
-	(*line)[ret] = 0;
+	if (!(ptr = (char*)realloc(p->buf, size + SDP_SCAN_PAD))) {
+		sdperr("memory acllocation");
+		return -1;
+	}
+	p->buf = ptr;
 
-	if (!ret) {
-		free(*line);
-		*line = NULL;
-		*len = 0;
-		return 0;
+	bits = (uint64_t*)realloc(p->bits, SDP_SCAN_WORDS(size) *
+		sizeof(uint64_t));
+	if (!bits) {
+		sdperr("memory acllocation");
+		return -1;
 	}
+	p->bits = bits;
 
-	return ret;
+	p->size = size;
+	return 0;
 }
 
 static char sdp_parse_descriptor_type(char *line)
@@ -113,96 +195,237 @@ static char sdp_parse_descriptor_type(char *line)
 	return descriptor;
 }
 
-static enum sdp_parse_err sdp_parse_non_supported(sdp_stream_t sdp, char **line,
-		size_t *len, char *not_supported)
+/* returns SDP_PARSE_OK if the line is one of the non supported descriptors
+ * and has been skipped, SDP_PARSE_NOT_SUPPORTED if the line belongs to
+ * another descriptor */
+static enum sdp_parse_err sdp_parse_non_supported(char *line,
+		char *not_supported)
 {
-	if (!*line)
-		return SDP_PARSE_OK;
-
-	do {
-		if (!sdp_parse_descriptor_type(*line))
-			return SDP_PARSE_ERROR;
-
-		if (!strchr(not_supported, **line))
-			return SDP_PARSE_NOT_SUPPORTED;
+	if (!sdp_parse_descriptor_type(line))
+		return SDP_PARSE_ERROR;
 
-		sdp_getline(line, len, sdp);
-	} while (*line);
+	if (!strchr(not_supported, *line))
+		return SDP_PARSE_NOT_SUPPORTED;
 
-	return SDP_PARSE_NOT_SUPPORTED;
+	return SDP_PARSE_OK;
 }
 
-static enum sdp_parse_err sdp_parse_version(sdp_stream_t sdp, char **line,
-		size_t *len, struct sdp_session_v *v)
+static enum sdp_parse_err sdp_parse_version(char *line,
+		struct sdp_session_v *v)
 {
 	int version;
 	char *ptr;
 	char *endptr;
 
-	if (!sdp_getline(line, len, sdp)||
-			sdp_parse_descriptor_type(*line) != 'v') {
+	if (sdp_parse_descriptor_type(line) != 'v') {
 		sdperr("missing required sdp version");
 		return SDP_PARSE_ERROR;
 	}
 
-	ptr = *line + 2;
+	ptr = line + 2;
 	version = strtol(ptr, &endptr, 10);
 	if (*endptr) {
-		sdperr("bad version - %s", *line);
+		sdperr("bad version - %s", line);
 		return SDP_PARSE_ERROR;
 	}
 
 	v->version = version;
-
-	if (!sdp_getline(line, len, sdp)) {
-		sdperr("no more sdp fields after version");
-		return SDP_PARSE_ERROR;
-	}
-
 	return SDP_PARSE_OK;
 }
 
-static enum sdp_parse_err sdp_parse_session_name(sdp_stream_t sdp, char **line,
-		size_t *len, char **s)
+static enum sdp_parse_err sdp_parse_session_name(
+		struct sdp_session *session, char *line, char **s)
 {
 	char *ptr;
 
-	if (strncmp(*line, "s=", 2)) {
+	if (strncmp(line, "s=", 2)) {
 		sdperr("missing required sdp session name");
 		return SDP_PARSE_ERROR;
 	}
 
-	ptr = *line + 2;
+	ptr = line + 2;
 	if (!*ptr) {
 		sdperr("sdp session name cannot remain empty");
 		return SDP_PARSE_ERROR;
 	}
 
-	*s = strdup(ptr);
+	*s = sdp_session_strdup(session, ptr);
 	if (!*s) {
 		sdperr("memory acllocation");
 		return SDP_PARSE_ERROR;
 	}
 
-	if (!sdp_getline(line, len, sdp)) {
-		sdperr("no more sdp fields after session name");
-		free(*s);
-		*s = NULL;
+	return SDP_PARSE_OK;
+}
+
+/* dotted-quad, as inet_pton(AF_INET), returns the end of the address or
+ * NULL */
+static const char *sdp_addr_parse_ip4(const char *str, uint8_t *bytes)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		unsigned int octet = 0;
+		int digits;
+
+		if (i && *str++ != '.')
+			return NULL;
+
+		for (digits = 0; *str >= '0' && *str <= '9'; digits++, str++) {
+			/* no leading zeros */
+			if (digits && !octet)
+				return NULL;
+
+			octet = octet * 10 + (*str - '0');
+			if (octet > 255)
+				return NULL;
+		}
+		if (!digits)
+			return NULL;
+
+		bytes[i] = (uint8_t)octet;
+	}
+
+	return str;
+}
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+/* hex groups with at most one "::" and an optional dotted-quad tail, as
+ * inet_pton(AF_INET6) */
+static int sdp_addr_parse_ip6(const char *str, uint8_t *bytes)
+{
+	uint8_t words[16];
+	int n = 0; /* bytes parsed */
+	int gap = -1; /* where "::" stands */
+
+	if (*str == ':') {
+		if (*++str != ':')
+			return -1;
+
+		str++;
+		gap = 0;
+	}
+
+	while (*str) {
+		const char *end = str;
+		unsigned int word = 0;
+		int digit;
+
+		for ( ; end - str < 5 && (digit = hex_digit(*end)) >= 0; end++)
+			word = word << 4 | digit;
+
+		if (*end == '.') {
+			/* the last 32 bits */
+			if (n > 12 || !(end = sdp_addr_parse_ip4(str,
+					&words[n])) || *end) {
+				return -1;
+			}
+
+			n += 4;
+			break;
+		}
+
+		if (end == str || end - str > 4 || n == 16)
+			return -1;
+
+		words[n++] = word >> 8;
+		words[n++] = word & 0xff;
+
+		if (!*end)
+			break;
+		if (*end != ':')
+			return -1;
+
+		str = end + 1;
+		if (*str == ':') {
+			if (gap >= 0)
+				return -1;
+
+			gap = n;
+			str++;
+		} else if (!*str) {
+			return -1;
+		}
+	}
+
+	if (gap < 0) {
+		if (n != 16)
+			return -1;
+
+		memcpy(bytes, words, 16);
+		return 0;
+	}
+
+	/* "::" stands for one or more groups of zeros */
+	if (n == 16)
+		return -1;
+
+	memset(bytes, 0, 16);
+	memcpy(bytes, words, gap);
+	memcpy(bytes + 16 - (n - gap), words + gap, n - gap);
+	return 0;
+}
+
+/* parses the address and keeps its text if asked to or if the address is a
+ * name */
+static enum sdp_parse_err sdp_addr_parse(struct sdp_session *session,
+		enum sdp_ci_addrtype addrtype, const char *str,
+		struct sdp_addr *addr, char **text)
+{
+	const char *end;
+
+	switch (addrtype) {
+	case SDP_CI_ADDRTYPE_IPV4:
+		end = sdp_addr_parse_ip4(str, (uint8_t*)&addr->u.ip4);
+		addr->is_name = !end || *end;
+		break;
+	case SDP_CI_ADDRTYPE_IPV6:
+		addr->is_name = sdp_addr_parse_ip6(str,
+			(uint8_t*)&addr->u.ip6) ? 1 : 0;
+		break;
+	default:
+		addr->is_name = 1;
+		break;
+	}
+
+	if (addr->is_name)
+		memset(&addr->u, 0, sizeof(addr->u));
 
+	if (!addr->is_name && !session->is_addr_text)
+		return SDP_PARSE_OK;
+
+	if (!(*text = sdp_session_strdup(session, str))) {
+		sdperr("memory acllocation");
 		return SDP_PARSE_ERROR;
 	}
 
 	return SDP_PARSE_OK;
 }
 
-static int is_multicast_addr(enum sdp_ci_addrtype addrtype, char *addr)
+static int is_multicast_addr(enum sdp_ci_addrtype addrtype,
+		const struct sdp_addr *addr)
 {
+	if (addr->is_name)
+		return 0;
+
 	switch (addrtype) {
 	case SDP_CI_ADDRTYPE_IPV4:
-		return ((unsigned long)inet_addr(addr) & htonl(0xf0000000)) ==
-			htonl(0xe0000000); /* 224.0.0.0 - 239.255.255.255 */
+		/* 224.0.0.0 - 239.255.255.255 */
+		return (((const uint8_t*)&addr->u.ip4)[0] & 0xf0) == 0xe0;
 	case SDP_CI_ADDRTYPE_IPV6:
-		/* not supported */
+		/* ff00::/8 */
+		return addr->u.ip6.s6_addr[0] == 0xff;
 	default:
 		break;
 	}
@@ -210,98 +433,121 @@ static int is_multicast_addr(enum sdp_ci_addrtype addrtype, char *addr)
 	return 0;
 }
 
-static enum sdp_parse_err sdp_parse_connection_information(sdp_stream_t sdp,
-		char **line, size_t *len, struct sdp_connection_information *c)
+static enum sdp_ci_addrtype sdp_addrtype_get(const char *addrtype)
+{
+	if (!strncmp(addrtype, "IP4", strlen("IP4")))
+		return SDP_CI_ADDRTYPE_IPV4;
+	if (!strncmp(addrtype, "IP6", strlen("IP6")))
+		return SDP_CI_ADDRTYPE_IPV6;
+
+	return SDP_CI_ADDRTYPE_NOT_SUPPORTED;
+}
+
+/* c=<nettype> <addrtype> <base address>[/<ttl>][/<number of addresses>],
+ * IP6 addresses having no ttl */
+static enum sdp_parse_err sdp_parse_connection_information(
+		struct sdp_session *session, struct sdp_scan *scan,
+		struct sdp_connection_information *c)
 {
 	char *nettype;
 	char *addrtype;
 	char *addr;
-	char *ptr;
-	char *tmp;
-	int ttl = 0;
-	int is_ttl_set = 0;
-
-	if (strncmp(*line, "c=", 2))
-		return SDP_PARSE_OK;
+	char *suffix[2] = { NULL, NULL };
+	long num[2] = { 0, 1 };
+	int i;
 
-	ptr = *line + 2;
-	nettype = strtok_r(ptr, " ", &tmp);
+	nettype = sdp_scan_token(scan, scan->line + 2, " ");
 	if (!nettype) {
 		sdperr("bad connection information nettype");
 		return SDP_PARSE_ERROR;
 	}
-	addrtype = strtok_r(NULL, " ", &tmp);
+	addrtype = sdp_scan_token(scan, NULL, " ");
 	if (!addrtype) {
 		sdperr("bad connection information addrtype");
 		return SDP_PARSE_ERROR;
 	}
 
-	addr = strtok_r(NULL, "/", &tmp);
-	if (!addr) {
-		addr = tmp;
-	} else {
-		char *endptr;
+	if (!strncmp(nettype, "IN", strlen("IN")))
+		c->nettype = SDP_CI_NETTYPE_IN;
+	else
+		c->nettype = SDP_CI_NETTYPE_NOT_SUPPORTED;
 
-		ttl = strtol(tmp, &endptr, 10);
-		if (*endptr) {
-			sdperr("bad connection information ttl");
+	c->addrtype = sdp_addrtype_get(addrtype);
+
+	if (!(addr = sdp_scan_token(scan, NULL, " /")))
+		addr = scan->pos;
+	for (i = 0; i < 2 && scan->delim == '/'; i++)
+		suffix[i] = sdp_scan_token(scan, NULL, " /");
+
+	if (*scan->pos) {
+		sdperr("bad connection information address");
+		return SDP_PARSE_ERROR;
+	}
+
+	/* an IP6 address is followed by the number of addresses alone */
+	if (c->addrtype == SDP_CI_ADDRTYPE_IPV6 && suffix[0]) {
+		if (suffix[1]) {
+			sdperr("bad connection information address");
 			return SDP_PARSE_ERROR;
 		}
 
-		if (ttl)
-			is_ttl_set = 1;
+		suffix[1] = suffix[0];
+		suffix[0] = NULL;
 	}
 
-	if (!strncmp(nettype, "IN", strlen("IN")))
-		c->nettype = SDP_CI_NETTYPE_IN;
-	else
-		c->nettype = SDP_CI_NETTYPE_NOT_SUPPORTED;
+	for (i = 0; i < 2; i++) {
+		char *endptr;
+
+		if (!suffix[i])
+			continue;
 
-	if (!strncmp(addrtype, "IP4", strlen("IP4"))) {
-		if (!is_ttl_set && is_multicast_addr(SDP_CI_ADDRTYPE_IPV4,
-				addr)) {
-			sdperr("connection information with an IP4 multicast "
-				"address requires a TTL value");
+		num[i] = strtol(suffix[i], &endptr, 10);
+		if (*endptr || num[i] < i) {
+			sdperr("bad connection information %s", i ? "number "
+				"of addresses" : "ttl");
 			return SDP_PARSE_ERROR;
 		}
+	}
 
-		c->addrtype = SDP_CI_ADDRTYPE_IPV4;
-	} else if (!strncmp(nettype, "IP6", strlen("IP6"))) {
-		c->addrtype = SDP_CI_ADDRTYPE_IPV6;
-	} else {
-		c->addrtype = SDP_CI_ADDRTYPE_NOT_SUPPORTED;
+	if (sdp_addr_parse(session, c->addrtype, addr, &c->addr,
+			&c->sdp_ci_addr) == SDP_PARSE_ERROR) {
+		return SDP_PARSE_ERROR;
+	}
+
+	if (c->addrtype == SDP_CI_ADDRTYPE_IPV4 && !num[0] &&
+			is_multicast_addr(SDP_CI_ADDRTYPE_IPV4, &c->addr)) {
+		sdperr("connection information with an IP4 multicast "
+			"address requires a TTL value");
+		return SDP_PARSE_ERROR;
 	}
 
-	strncpy(c->sdp_ci_addr, addr, sizeof(c->sdp_ci_addr));
-	c->sdp_ci_ttl = ttl;
-	c->count = 1;
+	c->sdp_ci_ttl = (int)num[0];
+	c->count = (int)num[1];
 
-	sdp_getline(line, len, sdp);
 	return SDP_PARSE_OK;
 }
 
-static enum sdp_parse_err sdp_parse_media_video(struct sdp_media_m *m,
-		char **tmp)
+static enum sdp_parse_err sdp_parse_media_video(struct sdp_session *session,
+		struct sdp_media_m *m, struct sdp_scan *scan)
 {
 	char *proto;
 	int port;
 	int num_ports;
 	int fmt;
-	char *slash;
 	char *endptr;
 	struct sdp_media_fmt **smf;
 
 	m->type = SDP_MEDIA_TYPE_VIDEO;
 
-	slash = strchr(*tmp, '/');
-	port = strtol(strtok_r(NULL, " /", tmp), &endptr, 10);
+	port = strtol(sdp_scan_token(scan, NULL, " /"), &endptr, 10);
 	if (*endptr) {
 		sdperr("bad media descriptor - port");
 		return SDP_PARSE_ERROR;
 	}
 
-	if (slash + 1 == *tmp) {
-		num_ports = strtol(strtok_r(NULL, " ", tmp), &endptr, 10);
+	if (scan->delim == '/') {
+		num_ports = strtol(sdp_scan_token(scan, NULL, " "), &endptr,
+			10);
 		if (*endptr) {
 			sdperr("bad media descriptor - num_ports");
 			return SDP_PARSE_ERROR;
@@ -310,8 +556,8 @@ static enum sdp_parse_err sdp_parse_media_video(struct sdp_media_m *m,
 		num_ports = 1;
 	}
 
-	proto = strtok_r(NULL, " ", tmp);
-	fmt = strtol(strtok_r(NULL, " ", tmp), &endptr, 10);
+	proto = sdp_scan_token(scan, NULL, " ");
+	fmt = strtol(sdp_scan_token(scan, NULL, " "), &endptr, 10);
 	if (*endptr) {
 		sdperr("bad media descriptor - fmt");
 		return SDP_PARSE_ERROR;
@@ -330,14 +576,14 @@ static enum sdp_parse_err sdp_parse_media_video(struct sdp_media_m *m,
 	m->fmt.id = fmt;
 
 	smf = &m->fmt.next;
-	while (*tmp && **tmp) {
-		if (!(*smf = (struct sdp_media_fmt*)calloc(1,
-                		sizeof(struct sdp_media_fmt)))) {
+	while (*scan->pos) {
+		if (!(*smf = (struct sdp_media_fmt*)sdp_session_alloc(session,
+				sizeof(struct sdp_media_fmt)))) {
 			sdperr("memory acllocation");
 			return SDP_PARSE_ERROR;
 		}
 
-		fmt = strtol(strtok_r(NULL, " ", tmp), &endptr, 10);
+		fmt = strtol(sdp_scan_token(scan, NULL, " "), &endptr, 10);
 		if (*endptr) {
 			sdperr("bad media descriptor - fmt");
 			return SDP_PARSE_ERROR;
@@ -348,20 +594,19 @@ static enum sdp_parse_err sdp_parse_media_video(struct sdp_media_m *m,
 
 	return SDP_PARSE_OK;
 }
-static enum sdp_parse_err sdp_parse_media_audio(struct sdp_media_m *m,
-    char **tmp)
+static enum sdp_parse_err sdp_parse_media_audio(struct sdp_session *session,
+    struct sdp_media_m *m, struct sdp_scan *scan)
 {
     m->type = SDP_MEDIA_TYPE_AUDIO;
-    char* slash = strchr(*tmp, '/');
     char* endptr;
-    int port = strtol(strtok_r(NULL, " /", tmp), &endptr, 10);
+    int port = strtol(sdp_scan_token(scan, NULL, " /"), &endptr, 10);
     if (*endptr) {
         sdperr("bad media descriptor - port");
         return SDP_PARSE_ERROR;
     }
     int num_ports;
-    if (slash + 1 == *tmp) {
-        num_ports = strtol(strtok_r(NULL, " ", tmp), &endptr, 10);
+    if (scan->delim == '/') {
+        num_ports = strtol(sdp_scan_token(scan, NULL, " "), &endptr, 10);
         if (*endptr) {
             sdperr("bad media descriptor - num_ports");
             return SDP_PARSE_ERROR;
@@ -370,8 +615,8 @@ static enum sdp_parse_err sdp_parse_media_audio(struct sdp_media_m *m,
     else {
         num_ports = 1;
     }
-    char *proto = strtok_r(NULL, " ", tmp);
-    int fmt = strtol(strtok_r(NULL, " ", tmp), &endptr, 10);
+    char *proto = sdp_scan_token(scan, NULL, " ");
+    int fmt = strtol(sdp_scan_token(scan, NULL, " "), &endptr, 10);
     if (*endptr) {
         sdperr("bad media descriptor - fmt");
         return SDP_PARSE_ERROR;
@@ -389,14 +634,14 @@ static enum sdp_parse_err sdp_parse_media_audio(struct sdp_media_m *m,
     m->num_ports = num_ports;
     m->fmt.id = fmt;
     struct sdp_media_fmt **smf = &m->fmt.next;
-    while (*tmp && **tmp) {
-        if (!(*smf = (struct sdp_media_fmt*)calloc(1,
+    while (*scan->pos) {
+        if (!(*smf = (struct sdp_media_fmt*)sdp_session_alloc(session,
             sizeof(struct sdp_media_fmt)))) {
             sdperr("memory acllocation");
             return SDP_PARSE_ERROR;
         }
 
-        fmt = strtol(strtok_r(NULL, " ", tmp), &endptr, 10);
+        fmt = strtol(sdp_scan_token(scan, NULL, " "), &endptr, 10);
         if (*endptr) {
             sdperr("bad media descriptor - fmt");
             return SDP_PARSE_ERROR;
@@ -416,157 +661,351 @@ static enum sdp_parse_err sdp_parse_media_not_supported(struct sdp_media_m *m,
 	return SDP_PARSE_NOT_SUPPORTED;
 }
 
-static enum sdp_parse_err sdp_parse_media(sdp_stream_t sdp, char **line,
-		size_t *len, struct sdp_media_m *m)
+static enum sdp_parse_err sdp_parse_media(struct sdp_session *session,
+		struct sdp_scan *scan, struct sdp_media_m *m)
 {
 	char *type;
-	char *ptr;
-	char *tmp;
 	enum sdp_parse_err err;
 
-	if (strncmp(*line, "m=", 2)) {
+	if (strncmp(scan->line, "m=", 2)) {
 		sdperr("bad media descriptor - m=");
 		return SDP_PARSE_ERROR;
 	}
 
-	ptr = *line + 2;
-	type = strtok_r(ptr, " ", &tmp);
+	type = sdp_scan_token(scan, scan->line + 2, " ");
 	if (!type) {
 		sdperr("bad media descriptor");
 		return SDP_PARSE_ERROR;
 	}
 
 	if (!strncmp(type, "video", strlen("video"))) {
-		err = sdp_parse_media_video(m, &tmp);
+		err = sdp_parse_media_video(session, m, scan);
 	} 
     else if(!strncmp(type, "audio", strlen("audio")))
     {
-        err = sdp_parse_media_audio(m, &tmp);
+        err = sdp_parse_media_audio(session, m, scan);
     }
     else {
 		err = sdp_parse_media_not_supported(m, type);
 	}
 
-	sdp_getline(line, len, sdp);
 	return err;
 }
 
-static enum sdp_parse_err parse_attr_common(struct sdp_attr *a, char *attr,
-		char *value, char *params,
-		parse_attr_specific_t parse_attr_specific)
+#define SDP_ATTR_LEVEL_SESSION (1 << 0)
+#define SDP_ATTR_LEVEL_MEDIA (1 << 1)
+
+/* supported attributes and the levels they may appear at. Not supported as
+ * yet: recvonly, sendrecv, sendonly, inactive, sdplang, lang (either
+ * level), ptime, maxptime, orient, framerate, quality (media level) */
+static const struct {
+	const char *name;
+	unsigned int levels;
+} sdp_attr_names[] = {
+	[SDP_ATTR_GROUP] = { "group", SDP_ATTR_LEVEL_SESSION },
+	[SDP_ATTR_RTPMAP] = { "rtpmap", SDP_ATTR_LEVEL_MEDIA },
+	[SDP_ATTR_FMTP] = { "fmtp", SDP_ATTR_LEVEL_MEDIA },
+	[SDP_ATTR_SOURCE_FILTER] = { "source-filter", SDP_ATTR_LEVEL_MEDIA },
+	[SDP_ATTR_MID] = { "mid", SDP_ATTR_LEVEL_MEDIA },
+};
+
+#define SDP_ATTR_KEY(_len_, _first_) ((_len_) << 8 | (_first_))
+
+/* maps an attribute name to its type in a single step, switching on its
+ * length and first character, SDP_ATTR_NOT_SUPPORTED if it is not known */
+static enum sdp_attr_type sdp_attr_type_get(const char *attr, size_t len)
+{
+	enum sdp_attr_type type;
+
+	if (len > 0xffff)
+		return SDP_ATTR_NOT_SUPPORTED;
+
+	switch (SDP_ATTR_KEY(len, (unsigned char)*attr)) {
+	case SDP_ATTR_KEY(3, 'm'):
+		type = SDP_ATTR_MID;
+		break;
+	case SDP_ATTR_KEY(4, 'f'):
+		type = SDP_ATTR_FMTP;
+		break;
+	case SDP_ATTR_KEY(5, 'g'):
+		type = SDP_ATTR_GROUP;
+		break;
+	case SDP_ATTR_KEY(6, 'r'):
+		type = SDP_ATTR_RTPMAP;
+		break;
+	case SDP_ATTR_KEY(13, 's'):
+		type = SDP_ATTR_SOURCE_FILTER;
+		break;
+	default:
+		return SDP_ATTR_NOT_SUPPORTED;
+	}
+
+	return memcmp(attr, sdp_attr_names[type].name, len) ?
+		SDP_ATTR_NOT_SUPPORTED : type;
+}
+
+/* the parser an attribute is handed to for what is not parsed here */
+struct sdp_attr_specific {
+	sdp_attr_parser_t parse; /* NULL if there is none */
+	void *ctx;
+};
+
+/* profiles need not register a parser for every attribute */
+static enum sdp_parse_err parse_attr_not_registered(
+		struct sdp_session *session, struct sdp_media *media,
+		struct sdp_attr *a, char *attr, char *value, char *params,
+		void *ctx)
 {
+	NOT_IN_USE(session);
+	NOT_IN_USE(media);
 	NOT_IN_USE(a);
 	NOT_IN_USE(attr);
 	NOT_IN_USE(value);
 	NOT_IN_USE(params);
-	NOT_IN_USE(parse_attr_specific);
+	NOT_IN_USE(ctx);
+
+	return SDP_PARSE_NOT_SUPPORTED;
+}
+
+typedef enum sdp_parse_err (*parse_attr_level_t)(struct sdp_session *session,
+	struct sdp_media *media, struct sdp_attr *a, enum sdp_attr_type type,
+	char *attr, char *value, char *params, struct sdp_scan *scan,
+	struct sdp_attr_specific *specific);
+
+static enum sdp_parse_err parse_attr_session(struct sdp_session *session,
+	struct sdp_media *media, struct sdp_attr *a, enum sdp_attr_type type,
+	char *attr, char *value, char *params, struct sdp_scan *scan,
+	struct sdp_attr_specific *specific);
+static enum sdp_parse_err parse_attr_media(struct sdp_session *session,
+	struct sdp_media *media, struct sdp_attr *a, enum sdp_attr_type type,
+	char *attr, char *value, char *params, struct sdp_scan *scan,
+	struct sdp_attr_specific *specific);
+
+/* tokenizes the name of the attribute at str, an indexed line past its a=.
+ * Returns the type of the attribute, SDP_ATTR_NOT_SUPPORTED with no entry if
+ * it is not supported at this level */
+static enum sdp_attr_type sdp_attr_name_parse(struct sdp_parser *p,
+		struct sdp_scan *scan, char *str, struct sdp_media *media,
+		unsigned int level, char **attr,
+		const struct sdp_profile_entry **entry)
+{
+	enum sdp_attr_type type;
+
+	*entry = NULL;
+	if (!(*attr = sdp_scan_token(scan, str, ":")))
+		return SDP_ATTR_NOT_SUPPORTED;
+
+	type = sdp_attr_type_get(*attr, scan->len);
+	if (type != SDP_ATTR_NOT_SUPPORTED &&
+			!(sdp_attr_names[type].levels & level)) {
+		type = SDP_ATTR_NOT_SUPPORTED;
+	}
+
+	if (p->profile) {
+		*entry = sdp_profile_lookup(p->profile, *attr, scan->len,
+			media ? media->m.type : SDP_MEDIA_TYPE_NONE);
+	}
+
+	return type;
+}
+
+/* decodes the value of an attribute whose name is tokenized */
+static enum sdp_parse_err sdp_attr_value_parse(struct sdp_parser *p,
+		struct sdp_scan *scan, struct sdp_media *media,
+		struct sdp_attr *a, enum sdp_attr_type type, char *attr,
+		const struct sdp_profile_entry *entry,
+		parse_attr_level_t parse_level)
+{
+	struct sdp_attr_specific specific;
+	char *value = NULL;
+	char *params = NULL;
+
+	if (p->profile) {
+		specific.parse = entry ? entry->parser :
+			parse_attr_not_registered;
+		specific.ctx = entry ? entry->ctx : NULL;
+	} else {
+		specific.parse = p->parse_attr_specific;
+		specific.ctx = p->parse_ctx;
+	}
+
+	if (*scan->pos)
+		value = sdp_scan_token(scan, NULL, " ");
+	if (*scan->pos)
+		params = scan->pos;
+
+	if (type == SDP_ATTR_NOT_SUPPORTED) {
+		/* handed whole to the profile */
+		a->type = SDP_ATTR_SPECIFIC;
+		return entry->parser(p->session, media, a, attr, value,
+			params, entry->ctx);
+	}
+
+	return parse_level(p->session, media, a, type, attr, value, params,
+		scan, &specific);
+}
+
+/* records an attribute whose name is tokenized, as its type and its line
+ * from the name on, for sdp_attr_raw_decode() */
+static enum sdp_parse_err sdp_attr_record(struct sdp_parser *p,
+		struct sdp_scan *scan, struct sdp_media *media,
+		struct sdp_attr *a, enum sdp_attr_type type, char *attr)
+{
+	size_t len = scan->pos + strlen(scan->pos) - attr;
+	char *line;
+
+	/* the line is indexed in place once decoded */
+	line = (char*)sdp_session_alloc(p->session, len + 1 + SDP_SCAN_PAD);
+	if (!line)
+		return SDP_PARSE_ERROR;
+
+	memcpy(line, attr, len);
+	if (scan->delim)
+		line[scan->len] = scan->delim;
 
+	a->type = type == SDP_ATTR_NOT_SUPPORTED ? SDP_ATTR_SPECIFIC : type;
+	a->is_raw = 1;
+	a->value.raw.line = line;
+	a->value.raw.session = p->session;
+	a->value.raw.media = media;
 	return SDP_PARSE_OK;
 }
 
-static enum sdp_parse_err sdp_parse_attr(sdp_stream_t sdp, char **line,
-		size_t *len, struct sdp_media *media, struct sdp_attr **a,
-		char **attr_level,
-		enum sdp_parse_err (*parse_level)(struct sdp_media *media,
-			struct sdp_attr *a, char *attr, char *value,
-			char *params,
-			parse_attr_specific_t parse_attr_specific),
-		parse_attr_specific_t parse_attr_specific)
+/* decodes an attribute recorded by a lazy parse */
+static void sdp_attr_raw_decode(struct sdp_attr *a)
 {
-	char **supported_attr;
+	struct sdp_attr_value_raw raw = a->value.raw;
+	struct sdp_parser *p = raw.session->parser;
+	const struct sdp_profile_entry *entry;
+	enum sdp_attr_type type;
+	struct sdp_scan scan;
+	uint64_t *bits;
+	size_t len = strlen(raw.line);
 	char *attr;
-	char *value;
-	char *params;
-	enum sdp_parse_err err;
-	char *ptr = *line;
-	char *tmp = NULL;
-	struct sdp_attr **iter = a;
-	unsigned long long attr_mask;
 
-	char *common_level_attr[] = {
-#if 0
-		"recvonly",
-		"sendrecv",
-		"sendoly",
-		"inactive",
-		"sdplang",
-		"lang",
-#endif
-		NULL
-	};
-
-	while (*line && sdp_parse_descriptor_type(*line) == 'a') {
-		value = NULL;
-		params = NULL;
-		ptr = *line + 2;
-
-		attr = strtok_r(ptr, ":", &tmp);
-		if (*tmp)
-			value = strtok_r(NULL, " ", &tmp);
-		if (*tmp)
-			params = tmp;
-
-		*a = (struct sdp_attr*)calloc(1, sizeof(struct sdp_attr));
-		if (!*a) {
-			sdperr("memory acllocation");
-			return SDP_PARSE_ERROR;
-		}
+	/* decoded as if freshly allocated. The decoding may look up other
+	 * attributes of its level, see smpte2110_sdp_parse_fmtp_params(), but
+	 * not itself */
+	a->type = SDP_ATTR_NONE;
+	a->is_raw = 0;
+	memset(&a->value, 0, sizeof(union sdp_attr_value));
 
-		/* try to find a supported attribute in the session/media
-		 * common list */
-		for (supported_attr = common_level_attr; *supported_attr &&
-			strcmp(*supported_attr, attr); supported_attr++);
-		if (*supported_attr) {
-			err = parse_attr_common(*a, *supported_attr, value,
-				params, parse_attr_specific);
-			if (err == SDP_PARSE_ERROR) {
-				free(*a);
-				*a = NULL;
-				sdperr("parsing attribute: %s", attr);
-				return SDP_PARSE_ERROR;
-			}
+	bits = (uint64_t*)sdp_session_alloc(raw.session,
+		SDP_SCAN_WORDS(len) * sizeof(uint64_t));
+	if (!bits) {
+		sdperr("memory acllocation");
+		a->type = SDP_ATTR_NOT_SUPPORTED;
+		return;
+	}
+	sdp_scan_index(&scan, raw.line, len, bits);
 
-			a = &(*a)->next;
+	type = sdp_attr_name_parse(p, &scan, raw.line, raw.media, raw.media ?
+		SDP_ATTR_LEVEL_MEDIA : SDP_ATTR_LEVEL_SESSION, &attr, &entry);
+	if (sdp_attr_value_parse(p, &scan, raw.media, a, type, attr, entry,
+			raw.media ? parse_attr_media : parse_attr_session) ==
+			SDP_PARSE_ERROR) {
+		sdperr("parsing attribute: %s", attr);
+		a->type = SDP_ATTR_NOT_SUPPORTED;
+	}
+}
 
-			sdp_getline(line, len, sdp);
-			continue;
-		}
+/* an attribute level starts */
+static void sdp_parser_attr_start(struct sdp_parser *p,
+		struct sdp_attr **attr, struct sdp_attr_index *a_index)
+{
+	p->attr = attr;
+	p->a_index = a_index;
+	memset(p->a_tail, 0, sizeof(p->a_tail));
+}
 
-		/* try to find supported attribute in current level list */
-		for (supported_attr = attr_level; *supported_attr &&
-			strcmp(*supported_attr, attr); supported_attr++);
-		if (*supported_attr) {
-			err = parse_level(media, *a, *supported_attr,
-					value, params, parse_attr_specific);
-			if (err == SDP_PARSE_ERROR) {
-				free(*a);
-				*a = NULL;
-				sdperr("parsing attribute: %s", attr);
-				return SDP_PARSE_ERROR;
-			}
+/* indexed under its type once parsed, under the type it was recorded as
+ * for a lazy parse */
+static void sdp_attr_index_add(struct sdp_parser *p, struct sdp_attr *a)
+{
+	struct sdp_attr_index *a_index = p->a_index;
 
-			a = &(*a)->next;
+	if (a_index->mask & 1 << a->type)
+		p->a_tail[a->type]->next_type = a;
+	else
+		a_index->head[a->type] = a;
 
-			sdp_getline(line, len, sdp);
-			continue;
-		}
+	a_index->mask |= 1 << a->type;
+	p->a_tail[a->type] = a;
+}
+
+/* from the flat array while it has room, the pre-count is an upper bound
+ * unless a custom stream peeks short of what it reads */
+static struct sdp_attr *sdp_parser_attr_alloc(struct sdp_parser *p)
+{
+	struct sdp_session *session = p->session;
+
+	if (session->attr_flat && session->attr_count < p->attr_flat_size)
+		return &session->attr_flat[session->attr_count++];
+
+	session->attr_flat = NULL;
+	return (struct sdp_attr*)sdp_session_alloc(session,
+		sizeof(struct sdp_attr));
+}
+
+static enum sdp_parse_err sdp_parse_attr(struct sdp_parser *p, char *line,
+		struct sdp_media *media, unsigned int level,
+		parse_attr_level_t parse_level)
+{
+	enum sdp_attr_type type;
+	const struct sdp_profile_entry *entry;
+	char *attr;
+	enum sdp_parse_err err;
+	struct sdp_scan *scan = &p->scan;
+
+	type = sdp_attr_name_parse(p, scan, line + 2, media, level, &attr,
+		&entry);
 
-		/* attribute is not supported */
-		free(*a);
-		*a = NULL;
+	/* attribute is not supported at this level, nothing is allocated for
+	 * it */
+	if (type == SDP_ATTR_NOT_SUPPORTED && !entry)
+		return SDP_PARSE_OK;
+
+	if (!(*p->attr = sdp_parser_attr_alloc(p))) {
+		sdperr("memory acllocation");
+		return SDP_PARSE_ERROR;
+	}
 
-		sdp_getline(line, len, sdp);
+	if (p->session->is_lazy) {
+		err = sdp_attr_record(p, scan, media, *p->attr, type, attr);
+	} else {
+		err = sdp_attr_value_parse(p, scan, media, *p->attr, type,
+			attr, entry, parse_level);
+	}
+	if (err == SDP_PARSE_ERROR) {
+		/* released with the session */
+		*p->attr = NULL;
+		sdperr("parsing attribute: %s", attr);
+		return SDP_PARSE_ERROR;
 	}
 
-	/* assert no multiple instances of supported attributes */
-	for (attr_mask = 0; *iter; iter = &(*iter)->next) {
-		if ((*iter)->type == SDP_ATTR_NONE ||
-				(*iter)->type == SDP_ATTR_SPECIFIC ||
-				(*iter)->type == SDP_ATTR_NOT_SUPPORTED) {
+	sdp_attr_index_add(p, *p->attr);
+	if (media)
+		media->a_count++;
+	else
+		p->session->a_count++;
+	p->attr = &(*p->attr)->next;
+	return SDP_PARSE_OK;
+}
+
+/* assert no multiple instances of supported attributes, once the attribute
+ * block of a level is complete */
+static enum sdp_parse_err sdp_parse_attr_check(struct sdp_attr *a)
+{
+	unsigned long long attr_mask;
+
+	for (attr_mask = 0; a; a = a->next) {
+		if (a->type == SDP_ATTR_NONE ||
+				a->type == SDP_ATTR_SPECIFIC ||
+				a->type == SDP_ATTR_NOT_SUPPORTED) {
 			continue;
 		}
 
-		if (attr_mask & 1 << (*iter)->type) {
+		if (attr_mask & 1 << a->type) {
 			struct code2str attributes[] = {
 				{ SDP_ATTR_GROUP, "group" },
 				{ SDP_ATTR_RTPMAP, "rtpmap" },
@@ -575,29 +1014,31 @@ static enum sdp_parse_err sdp_parse_attr(sdp_stream_t sdp, char **line,
 				{ SDP_ATTR_MID, "mid" },
 				{ -1 }
 			};
-			char *type = code2str(attributes, (*iter)->type);
+			char *type = code2str(attributes, a->type);
 
 			sdperr("multiple instances of attribute: %s", type ?
 				type : "N/A");
 			return SDP_PARSE_ERROR;
 		}
 
-		attr_mask |= 1 << (*iter)->type;
+		attr_mask |= 1 << a->type;
 	}
 
 	return SDP_PARSE_OK;
 }
 
-static enum sdp_parse_err parse_attr_session(struct sdp_media *media,
-		struct sdp_attr *a, char *attr, char *value, char *params,
-		parse_attr_specific_t parse_attr_specific)
+static enum sdp_parse_err parse_attr_session(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a,
+		enum sdp_attr_type type, char *attr, char *value, char *params,
+		struct sdp_scan *scan, struct sdp_attr_specific *specific)
 {
-	if (!strncmp(attr, "group", strlen("group"))) {
+	if (type == SDP_ATTR_GROUP) {
 		/* currently not supporting the general case */
-		if (!parse_attr_specific)
+		if (!specific->parse)
 			return SDP_PARSE_NOT_SUPPORTED;
 
-		return parse_attr_specific(media, a, attr, value, params);
+		return specific->parse(session, media, a, attr, value, params,
+			specific->ctx);
 	} else {
 		a->type = SDP_ATTR_NOT_SUPPORTED;
 		return SDP_PARSE_NOT_SUPPORTED;
@@ -606,30 +1047,104 @@ static enum sdp_parse_err parse_attr_session(struct sdp_media *media,
 	return SDP_PARSE_OK;
 }
 
-static enum sdp_parse_err sdp_parse_session_level_attr(sdp_stream_t sdp,
-		char **line, size_t *len, struct sdp_attr **a,
-		parse_attr_specific_t parse_attr_specific)
+static enum sdp_parse_err sdp_parse_session_level_attr(struct sdp_parser *p,
+		char *line)
+{
+	return sdp_parse_attr(p, line, NULL, SDP_ATTR_LEVEL_SESSION,
+		parse_attr_session);
+}
+
+static size_t sdp_addr_hash(enum sdp_ci_addrtype addrtype,
+		const void *addr)
+{
+	uint64_t h;
+
+	if (addrtype == SDP_CI_ADDRTYPE_IPV4) {
+		uint32_t ip4;
+
+		memcpy(&ip4, addr, sizeof(ip4));
+		h = ip4;
+	} else {
+		uint64_t ip6[2];
+
+		memcpy(ip6, addr, sizeof(ip6));
+		h = ip6[0] ^ ip6[1] * FNV1A_PRIME;
+	}
+
+	/* Fibonacci hashing, the high bits folded onto the low ones the
+	 * table is indexed with */
+	h *= 0x9e3779b97f4a7c15ULL;
+	return (size_t)(h ^ h >> 32);
+}
+
+/* the slot of the source, or the free slot it would take */
+static struct source_filter_src_addr **sdp_source_filter_slot(
+		const struct sdp_attr_source_filter_spec *spec,
+		const void *addr)
 {
-	static char *session_level_attr[] = {
-		"group",
-		NULL
-	};
+	size_t len = spec->addrtype == SDP_CI_ADDRTYPE_IPV4 ?
+		sizeof(struct in_addr) : sizeof(struct in6_addr);
+	size_t mask = spec->src_table_size - 1;
+	size_t i = sdp_addr_hash(spec->addrtype, addr) & mask;
+
+	/* linear probing, there is always a free slot */
+	for ( ; spec->src_table[i]; i = (i + 1) & mask) {
+		if (!memcmp(&spec->src_table[i]->src.u, addr, len))
+			break;
+	}
+
+	return &spec->src_table[i];
+}
+
+/* a table of the binary source addresses, kept at most half full */
+static enum sdp_parse_err sdp_source_filter_table_build(
+		struct sdp_session *session,
+		struct sdp_attr_source_filter_spec *spec)
+{
+	struct source_filter_src_addr *src;
+
+	if (spec->addrtype != SDP_CI_ADDRTYPE_IPV4 &&
+			spec->addrtype != SDP_CI_ADDRTYPE_IPV6) {
+		return SDP_PARSE_OK;
+	}
+
+	for (spec->src_table_size = 2;
+		spec->src_table_size < (size_t)spec->src_list_len * 2;
+		spec->src_table_size <<= 1);
+
+	spec->src_table = (struct source_filter_src_addr**)sdp_session_alloc(
+		session, spec->src_table_size *
+		sizeof(struct source_filter_src_addr*));
+	if (!spec->src_table) {
+		sdperr("memory acllocation");
+		return SDP_PARSE_ERROR;
+	}
+
+	for (src = &spec->src_list; src; src = src->next) {
+		struct source_filter_src_addr **slot;
+
+		/* names are not resolved, they match no source */
+		if (src->src.is_name)
+			continue;
+
+		if (!*(slot = sdp_source_filter_slot(spec, &src->src.u)))
+			*slot = src;
+	}
 
-	return sdp_parse_attr(sdp, line, len, NULL, a, session_level_attr,
-		parse_attr_session, parse_attr_specific);
+	return SDP_PARSE_OK;
 }
 
 static enum sdp_parse_err sdp_parse_attr_source_filter(
+		struct sdp_session *session,
 		struct sdp_attr_value_source_filter *source_filter,
-		char *value, char *params)
+		char *value, char *params, struct sdp_scan *scan)
 {
 	char *nettype;
 	char *addrtype;
 	char *dst_addr;
 	char *src_addr;
-	char *tmp;
-	struct source_filter_src_addr src_list;
-	int src_list_len;
+	struct sdp_attr_source_filter_spec *spec = &source_filter->spec;
+	struct source_filter_src_addr *src;
 
 	/* filter-mode */
 	if (!strncmp(value, "incl", strlen("incl"))) {
@@ -642,92 +1157,91 @@ static enum sdp_parse_err sdp_parse_attr_source_filter(
 	}
 
 	/* filter-spec */
-	nettype = strtok_r(params, " ", &tmp);
+	nettype = sdp_scan_token(scan, params, " ");
 	if (!nettype) {
 		sdperr("bad source-filter nettype");
 		return SDP_PARSE_ERROR;
 	}
 
-	addrtype = strtok_r(NULL, " ", &tmp);
+	addrtype = sdp_scan_token(scan, NULL, " ");
 	if (!addrtype) {
 		sdperr("bad source-filter addrtype");
 		return SDP_PARSE_ERROR;
 	}
 
-	dst_addr = strtok_r(NULL, " ", &tmp);
+	dst_addr = sdp_scan_token(scan, NULL, " ");
 	if (!dst_addr) {
 		sdperr("bad source-filter dst-addr");
 		return SDP_PARSE_ERROR;
 	}
 
-	src_addr = strtok_r(NULL, " ", &tmp);
+	src_addr = sdp_scan_token(scan, NULL, " ");
 	if (!src_addr) {
 		sdperr("bad source-filter src-addr");
 		return SDP_PARSE_ERROR;
 	}
-	memset(&src_list, 0, sizeof(struct source_filter_src_addr));
-	strncpy(src_list.addr, src_addr, sizeof(src_list.addr));
-	src_list.next = NULL;
-	src_list_len = 1;
-
-	while (*tmp) {
-		/* limitation:
-		 * rfc4570 defines a list of source addresses.
-		 * The current implementation supports only a single source
-		 * address */
-		sdpwarn("source filter attribute currently supports a "
-			"single source address");
-		*tmp = 0;
-	}
-
 	if (!strncmp(nettype, "IN", strlen("IN")))
-		source_filter->spec.nettype = SDP_CI_NETTYPE_IN;
+		spec->nettype = SDP_CI_NETTYPE_IN;
 	else
-		source_filter->spec.nettype = SDP_CI_NETTYPE_NOT_SUPPORTED;
+		spec->nettype = SDP_CI_NETTYPE_NOT_SUPPORTED;
 
-	if (!strncmp(addrtype, "IP4", strlen("IP4")))
-		source_filter->spec.addrtype = SDP_CI_ADDRTYPE_IPV4;
-	else if (!strncmp(nettype, "IP6", strlen("IP6")))
-		source_filter->spec.addrtype = SDP_CI_ADDRTYPE_IPV6;
-	else
-		source_filter->spec.addrtype = SDP_CI_ADDRTYPE_NOT_SUPPORTED;
+	spec->addrtype = sdp_addrtype_get(addrtype);
 
-	strncpy(source_filter->spec.dst_addr, dst_addr,
-		sizeof(source_filter->spec.dst_addr));
+	if (sdp_addr_parse(session, spec->addrtype, dst_addr, &spec->dst,
+			&spec->dst_addr) == SDP_PARSE_ERROR) {
+		return SDP_PARSE_ERROR;
+	}
 
-	memcpy(&source_filter->spec.src_list, &src_list,
-		sizeof(struct source_filter_src_addr));
+	/* src-list, the first source held in place */
+	for (src = &spec->src_list; src_addr;
+			src_addr = sdp_scan_token(scan, NULL, " ")) {
+		if (spec->src_list_len) {
+			src->next = (struct source_filter_src_addr*)
+				sdp_session_alloc(session,
+				sizeof(struct source_filter_src_addr));
+			if (!src->next) {
+				sdperr("memory acllocation");
+				return SDP_PARSE_ERROR;
+			}
+			src = src->next;
+		}
 
-	source_filter->spec.src_list_len = src_list_len;
-	return SDP_PARSE_OK;
-}
+		if (sdp_addr_parse(session, spec->addrtype, src_addr,
+				&src->src, &src->addr) == SDP_PARSE_ERROR) {
+			return SDP_PARSE_ERROR;
+		}
+		spec->src_list_len++;
+	}
 
-static enum sdp_parse_err parse_attr_media(struct sdp_media *media,
-		struct sdp_attr *a, char *attr, char *value, char *params,
-		parse_attr_specific_t parse_attr_specific)
+	return sdp_source_filter_table_build(session, spec);
+}
+
+static enum sdp_parse_err parse_attr_media(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a,
+		enum sdp_attr_type type, char *attr, char *value, char *params,
+		struct sdp_scan *scan, struct sdp_attr_specific *specific)
 {
 	char *endptr;
 
-	if (!strncmp(attr, "rtpmap", strlen("rtpmap"))) {
+	if (type == SDP_ATTR_RTPMAP) {
 		struct sdp_attr_value_rtpmap *rtpmap = &a->value.rtpmap;
 		char *media_subtype, *clock_rate;
-		char *tmp;
 
 		a->type = SDP_ATTR_RTPMAP;
 
-		media_subtype = strtok_r(params, "/", &tmp);
-		if (!media_subtype || !tmp) {
+		media_subtype = sdp_scan_token(scan, params, "/");
+		if (!media_subtype || !scan->pos) {
 			sdperr("attribute bad format - %s (media_subtype)",
 				attr);
 			return SDP_PARSE_ERROR;
 		}
 
-		clock_rate = strtok_r(NULL, "/", &tmp);
+		clock_rate = sdp_scan_token(scan, NULL, "/");
 		if (!clock_rate) {
 			sdperr("attribute bad format - %s (clock_rate)", attr);
 			return SDP_PARSE_ERROR;
 		}
-        char* channel_count = strtok_r(NULL, "/", &tmp); // for audio
+        char* channel_count = sdp_scan_token(scan, NULL, "/"); // for audio
         if (channel_count)
         {
             rtpmap->num_channel = strtol(channel_count, &endptr, 10);
@@ -748,15 +1262,19 @@ static enum sdp_parse_err parse_attr_media(struct sdp_media *media,
 			return SDP_PARSE_ERROR;
 		}
 
-		strncpy(rtpmap->media_subtype, media_subtype,
-			sizeof(rtpmap->media_subtype));
+		rtpmap->media_subtype = sdp_session_strdup(session,
+			media_subtype);
+		if (!rtpmap->media_subtype) {
+			sdperr("memory acllocation");
+			return SDP_PARSE_ERROR;
+		}
 
 		rtpmap->clock_rate = strtol(clock_rate, &endptr, 10);
 		if (*endptr) {
 			sdperr("attribute bad format - %s", attr);
 			return SDP_PARSE_ERROR;
 		}
-	} else if (!strncmp(attr, "fmtp", strlen("fmtp"))) {
+	} else if (type == SDP_ATTR_FMTP) {
 		struct sdp_attr_value_fmtp *fmtp = &a->value.fmtp;
 		char *endptr;
 
@@ -766,23 +1284,23 @@ static enum sdp_parse_err parse_attr_media(struct sdp_media *media,
 			return SDP_PARSE_ERROR;
 		}
 
-		if (*params && (!parse_attr_specific ||
-				parse_attr_specific(media, a, attr, value,
-				params) == SDP_PARSE_ERROR)) {
+		if (*params && (!specific->parse ||
+				specific->parse(session, media, a, attr, value,
+				params, specific->ctx) == SDP_PARSE_ERROR)) {
 			return SDP_PARSE_ERROR;
 		}
-	} else if (!strncmp(attr, "source-filter", strlen("source-filter"))) {
+	} else if (type == SDP_ATTR_SOURCE_FILTER) {
 		struct sdp_attr_value_source_filter *source_filter;
 
 		source_filter = &a->value.source_filter;
 		a->type = SDP_ATTR_SOURCE_FILTER;
 
-		if (sdp_parse_attr_source_filter(source_filter, value,
-				params)) {
+		if (sdp_parse_attr_source_filter(session, source_filter,
+				value, params, scan)) {
 			sdperr("attribute bad format - %s", attr);
 			return SDP_PARSE_ERROR;
 		}
-	} else if (!strncmp(attr, "mid", strlen("mid"))) {
+	} else if (type == SDP_ATTR_MID) {
 		char *identification_tag;
 
 		a->type = SDP_ATTR_MID;
@@ -792,7 +1310,8 @@ static enum sdp_parse_err parse_attr_media(struct sdp_media *media,
 			return SDP_PARSE_ERROR;
 		}
 
-		a->value.mid.identification_tag = strdup(value);
+		a->value.mid.identification_tag = sdp_session_strdup(session,
+			value);
 		if (!a->value.mid.identification_tag) {
 			sdperr("failed to allocate memory for "
 				"identification_tag: %s", value);
@@ -806,278 +1325,1021 @@ static enum sdp_parse_err parse_attr_media(struct sdp_media *media,
 	return SDP_PARSE_OK;
 }
 
-static enum sdp_parse_err sdp_parse_media_level_attr(sdp_stream_t sdp,
-		char **line, size_t *len, struct sdp_media *media,
-		struct sdp_attr **a, parse_attr_specific_t parse_attr_specific)
+static enum sdp_parse_err sdp_parse_media_level_attr(struct sdp_parser *p,
+		char *line)
 {
-	static char *media_level_attr[] = {
-#if 0
-		"ptime",
-		"maxptime",
-		"orient",
-		"framerate",
-		"quality",
-#endif
-		"rtpmap",
-		"fmtp",
-		"source-filter",
-		"mid",
-		NULL
-	};
-
-	return sdp_parse_attr(sdp, line, len, media, a, media_level_attr,
-		parse_attr_media, parse_attr_specific);
+	return sdp_parse_attr(p, line, p->media, SDP_ATTR_LEVEL_MEDIA,
+		parse_attr_media);
 }
 
-static void media_fmt_free(struct sdp_media_fmt *fmt)
+/* parameters allocated outside of the session arena are released through
+ * their destructor */
+static void sdp_attr_dtor(struct sdp_attr *attr)
 {
-	while (fmt) {
-		struct sdp_media_fmt *tmp;
+	for ( ; attr; attr = attr->next) {
+		if (attr->is_raw)
+			continue;
 
-		tmp = fmt;
-		fmt = fmt->next;
-		free(tmp);
+		if (attr->type == SDP_ATTR_FMTP && attr->value.fmtp.param_dtor)
+			attr->value.fmtp.param_dtor(attr->value.fmtp.params);
 	}
 }
 
-static void sdp_attr_free(struct sdp_attr *attr)
+/* as sdp_parser_attr_alloc() */
+static struct sdp_media *sdp_parser_media_alloc(struct sdp_parser *p)
 {
-	while (attr) {
-		struct sdp_attr *tmp;
+	struct sdp_session *session = p->session;
 
-		tmp = attr;
-		attr = attr->next;
+	if (session->media_flat && session->media_count < p->media_flat_size)
+		return &session->media_flat[session->media_count++];
 
-		switch (tmp->type) {
-		case SDP_ATTR_GROUP:
-		{
-			struct group_identification_tag *tag;
+	session->media_flat = NULL;
+	return (struct sdp_media*)sdp_session_alloc(session,
+		sizeof(struct sdp_media));
+}
+
+/* starts a new media block, the line must be an m= line */
+static enum sdp_parse_err sdp_parser_media_start(struct sdp_parser *p,
+		char *line)
+{
+	struct sdp_media *media;
+	struct sdp_media **next;
+	enum sdp_parse_err err;
 
-			while ((tag = tmp->value.group.tag)) {
-				tmp->value.group.tag =
-					tmp->value.group.tag->next;
+	if (sdp_parse_descriptor_type(line) != 'm')
+		return SDP_PARSE_ERROR;
 
-				free(tag->identification_tag);
-				free(tag);
-			}
+	/* add media to session, after the block parsed last if any */
+	next = p->media ? &p->media->next : &p->session->media;
+	for ( ; *next; next = &(*next)->next);
+	if (!(*next = sdp_parser_media_alloc(p)))
+		return SDP_PARSE_ERROR;
+
+	media = *next;
+	media->a_offset = p->session->attr_count;
+	p->media = media;
+
+	/* parse m= */
+	err = sdp_parse_media(p->session, &p->scan, &media->m);
+	if (err == SDP_PARSE_ERROR)
+		return SDP_PARSE_ERROR;
+
+	/* skip non suppored m= media blocks */
+	p->state = err == SDP_PARSE_NOT_SUPPORTED ?
+		SDP_PARSE_STATE_MEDIA_SKIP : SDP_PARSE_STATE_MEDIA_INFO;
+	return SDP_PARSE_OK;
+}
+
+/* parses a single line according to the section of the description
+ * reached so far */
+static enum sdp_parse_err sdp_parser_line(struct sdp_parser *p, char *line)
+{
+	struct sdp_session *session = p->session;
+	enum sdp_parse_err err;
+
+	p->is_line_required = 0;
 
-			free(tmp->value.group.semantic);
+	switch (p->state) {
+	case SDP_PARSE_STATE_VERSION:
+		/* parse v= */
+		if (sdp_parse_version(line, &session->v) == SDP_PARSE_ERROR)
+			return SDP_PARSE_ERROR;
+
+		p->state = SDP_PARSE_STATE_ORIGIN;
+		p->is_line_required = 1;
+		return SDP_PARSE_OK;
+	case SDP_PARSE_STATE_ORIGIN:
+		/* skip parsing of non supported session-level descriptors */
+		err = sdp_parse_non_supported(line, "o");
+		if (err != SDP_PARSE_NOT_SUPPORTED)
+			return err;
+
+		/* parse s= */
+		if (sdp_parse_session_name(session, line, &session->s) ==
+				SDP_PARSE_ERROR) {
+			return SDP_PARSE_ERROR;
 		}
+
+		p->state = SDP_PARSE_STATE_SESSION_INFO;
+		p->is_line_required = 1;
+		return SDP_PARSE_OK;
+	case SDP_PARSE_STATE_SESSION_INFO:
+		/* skip parsing of non supported session-level descriptors */
+		err = sdp_parse_non_supported(line, "iuep");
+		if (err != SDP_PARSE_NOT_SUPPORTED)
+			return err;
+
+		/* nothing except for (t=[v=]) is compulsory from here on */
+
+		/* parse c=* */
+		p->state = SDP_PARSE_STATE_SESSION_TIME;
+		if (!strncmp(line, "c=", 2)) {
+			return sdp_parse_connection_information(session,
+				&p->scan, &session->c);
+		}
+		/* fall through */
+	case SDP_PARSE_STATE_SESSION_TIME:
+		/* skip parsing of non supported session-level descriptors */
+		err = sdp_parse_non_supported(line, "btvuezk");
+		if (err != SDP_PARSE_NOT_SUPPORTED)
+			return err;
+
+		p->state = SDP_PARSE_STATE_SESSION_ATTR;
+		sdp_parser_attr_start(p, &session->a, &session->a_index);
+		/* fall through */
+	case SDP_PARSE_STATE_SESSION_ATTR:
+		if (sdp_parse_descriptor_type(line) == 'a')
+			return sdp_parse_session_level_attr(p, line);
+
+		if (sdp_parse_attr_check(session->a) == SDP_PARSE_ERROR)
+			return SDP_PARSE_ERROR;
+
+		/* parse media-level description */
+		return sdp_parser_media_start(p, line);
+	case SDP_PARSE_STATE_MEDIA_SKIP:
+		if (sdp_parse_descriptor_type(line) != 'm')
+			return SDP_PARSE_OK;
+
+		return sdp_parser_media_start(p, line);
+	case SDP_PARSE_STATE_MEDIA_INFO:
+		/* skip parsing of non supported media-level descriptors */
+		err = sdp_parse_non_supported(line, "i");
+		if (err != SDP_PARSE_NOT_SUPPORTED)
+			return err;
+
+		/* parse c=* */
+		p->state = SDP_PARSE_STATE_MEDIA_BANDWIDTH;
+		if (!strncmp(line, "c=", 2)) {
+			return sdp_parse_connection_information(p->session,
+				&p->scan, &p->media->c);
+		}
+		/* fall through */
+	case SDP_PARSE_STATE_MEDIA_BANDWIDTH:
+		/* skip parsing of non supported media-level descriptors */
+		err = sdp_parse_non_supported(line, "bk");
+		if (err != SDP_PARSE_NOT_SUPPORTED)
+			return err;
+
+		p->state = SDP_PARSE_STATE_MEDIA_ATTR;
+		sdp_parser_attr_start(p, &p->media->a, &p->media->a_index);
+		/* fall through */
+	case SDP_PARSE_STATE_MEDIA_ATTR:
+		/* parse media-level a=* */
+		if (sdp_parse_descriptor_type(line) == 'a')
+			return sdp_parse_media_level_attr(p, line);
+
+		if (sdp_parse_attr_check(p->media->a) == SDP_PARSE_ERROR)
+			return SDP_PARSE_ERROR;
+
+		return sdp_parser_media_start(p, line);
+	default:
 		break;
-		case SDP_ATTR_FMTP:
-			if (tmp->value.fmtp.param_dtor) {
-				tmp->value.fmtp.param_dtor(
-					tmp->value.fmtp.params);
-			}
-			break;
-		case SDP_ATTR_SOURCE_FILTER:
-			free(tmp->value.source_filter.spec.src_list.next);
-			break;
-		case SDP_ATTR_MID:
-			free(tmp->value.mid.identification_tag);
-			break;
-		case SDP_ATTR_SPECIFIC:
-			free(tmp->value.specific);
-			break;
-		case SDP_ATTR_RTPMAP:
-		case SDP_ATTR_NOT_SUPPORTED:
-		default:
+	}
+
+	return SDP_PARSE_ERROR;
+}
+
+/* parses a line of the indexed block, ending at eol, with no trailing
+ * whitespaces or line delimiters */
+static void sdp_parser_line_feed(struct sdp_parser *p, char *line, char *eol)
+{
+	while (eol > line && IS_WHITESPACE_DELIM(eol[-1]))
+		eol--;
+	*eol = 0;
+
+	/* an empty line terminates the description */
+	if (!*line) {
+		p->is_eos = 1;
+		return;
+	}
+
+	sdp_scan_line(&p->scan, line);
+	p->err = sdp_parser_line(p, line);
+}
+
+/* copies a block of input after the line held from the previous one,
+ * indexes it as a whole and parses the lines it completes. A last line that
+ * is not terminated is held, or parsed if is_last is set. Returns the number
+ * of bytes of the block consumed, all of them unless parsing stopped at an
+ * error or the end of the description */
+static size_t sdp_parser_block_feed(struct sdp_parser *p, const char *block,
+		size_t len, int is_last)
+{
+	size_t size = p->partial + len;
+	char *line;
+	char *eol;
+	char *end;
+
+	if (p->err != SDP_PARSE_OK || p->is_eos)
+		return 0;
+
+	if (sdp_parser_reserve(p, size + 1)) {
+		p->err = SDP_PARSE_ERROR;
+		return 0;
+	}
+
+	memcpy(p->buf + p->partial, block, len);
+	p->buf[size] = 0;
+	sdp_scan_index(&p->scan, p->buf, size, p->bits);
+
+	for (line = p->buf, end = p->buf + size; line < end; line = eol + 1) {
+		eol = sdp_scan_eol(&p->scan, line);
+		if (eol == end && !is_last)
 			break;
+
+		sdp_parser_line_feed(p, line, eol);
+		if (p->err != SDP_PARSE_OK || p->is_eos) {
+			/* consumed up to the end of the line */
+			len = eol < end ? eol + 1 - p->buf - p->partial :
+				len;
+			p->partial = 0;
+			return len;
 		}
+	}
+
+	/* the rest of the block is held */
+	p->partial = line < end ? end - line : 0;
+	memmove(p->buf, line, p->partial);
+	return len;
+}
+
+/* feeds input a block at a time, for the index to remain in cache */
+static size_t sdp_parser_input_feed(struct sdp_parser *p, const char *buf,
+		size_t len)
+{
+	size_t consumed = 0;
 
-		free(tmp);
+	while (consumed < len && p->err == SDP_PARSE_OK && !p->is_eos) {
+		size_t block = len - consumed < SDP_PARSE_BLOCK ?
+			len - consumed : SDP_PARSE_BLOCK;
+
+		consumed += sdp_parser_block_feed(p, buf + consumed, block, 0);
 	}
+
+	return consumed;
 }
 
-static void media_free(struct sdp_media *media)
+/* validates the description once there are no more lines to parse */
+static enum sdp_parse_err sdp_parser_validate(struct sdp_parser *p)
 {
-	while (media) {
-		struct sdp_media *tmp;
+	if (p->err != SDP_PARSE_OK)
+		return p->err;
 
-		tmp = media;
-		media = media->next;
+	switch (p->state) {
+	case SDP_PARSE_STATE_VERSION:
+		sdperr("missing required sdp version");
+		return SDP_PARSE_ERROR;
+	case SDP_PARSE_STATE_ORIGIN:
+		if (p->is_line_required)
+			sdperr("no more sdp fields after version");
+		else
+			sdperr("missing required sdp session name");
+		return SDP_PARSE_ERROR;
+	case SDP_PARSE_STATE_SESSION_INFO:
+		if (p->is_line_required) {
+			sdperr("no more sdp fields after session name");
+			p->session->s = NULL;
 
-		media_fmt_free(tmp->m.fmt.next);
-		sdp_attr_free(tmp->a);
+			return SDP_PARSE_ERROR;
+		}
+		break;
+	case SDP_PARSE_STATE_SESSION_ATTR:
+		return sdp_parse_attr_check(p->session->a);
+	case SDP_PARSE_STATE_MEDIA_ATTR:
+		return sdp_parse_attr_check(p->media->a);
+	default:
+		break;
+	}
+
+	return SDP_PARSE_OK;
+}
+
+/* attributes recorded by a lazy parse are decoded as they are looked for.
+ * attr is the first attribute of a level, or that following a previous
+ * match, and type_attr the first one of the type from there on */
+static struct sdp_attr *sdp_attr_locate(struct sdp_attr *attr,
+		struct sdp_attr *type_attr, enum sdp_attr_type type)
+{
+	if (attr && attr->is_raw)
+		sdp_attr_raw_decode(attr);
+	if (attr && attr->type == SDP_ATTR_NONE)
+		return attr;
+
+	/* attributes are indexed under the type a lazy parse records, that
+	 * of their name. Decoding them may only turn them into one of these,
+	 * which are walked for instead */
+	if (type == SDP_ATTR_NONE || type == SDP_ATTR_NOT_SUPPORTED) {
+		for ( ; attr; attr = attr->next) {
+			if (attr->is_raw)
+				sdp_attr_raw_decode(attr);
 
-		free(tmp);
+			if (attr->type == type)
+				break;
+		}
+
+		return attr;
 	}
+
+	for ( ; type_attr; type_attr = type_attr->next_type) {
+		if (type_attr->is_raw)
+			sdp_attr_raw_decode(type_attr);
+
+		if (type_attr->type == type)
+			break;
+	}
+
+	return type_attr;
 }
 
-struct sdp_session *sdp_parser_init(enum sdp_stream_type type, void *ctx)
+/* the a=mid identification tag of a media, NULL if it has none. Looked up by
+ * type, the accessor returns an untyped first attribute whatever the type */
+static const char *sdp_media_mid(struct sdp_media *media)
+{
+	struct sdp_attr *a;
+
+	a = sdp_attr_locate(NULL, media->a_index.head[SDP_ATTR_MID],
+		SDP_ATTR_MID);
+
+	return a ? a->value.mid.identification_tag : NULL;
+}
+
+static size_t sdp_mid_hash(const char *mid)
+{
+	uint64_t h = FNV1A_OFFSET;
+
+	for ( ; *mid; mid++)
+		h = (h ^ (uint8_t)*mid) * FNV1A_PRIME;
+
+	return (size_t)h;
+}
+
+static struct sdp_media **sdp_mid_slot(struct sdp_media_index *m_index,
+		const char *mid)
+{
+	size_t i = sdp_mid_hash(mid) & (m_index->mid_size - 1);
+
+	/* linear probing, there is always a free slot */
+	for ( ; m_index->mid[i]; i = (i + 1) & (m_index->mid_size - 1)) {
+		if (!strcmp(sdp_media_mid(m_index->mid[i]), mid))
+			break;
+	}
+
+	return &m_index->mid[i];
+}
+
+/* media arrays by type and a table of media by a=mid, which decodes the mid
+ * attributes of a lazy parse */
+static enum sdp_parse_err sdp_media_index_build(struct sdp_session *session)
+{
+	struct sdp_media_index *m_index;
+	struct sdp_media **slots;
+	struct sdp_media *media;
+	size_t fill[SDP_MEDIA_TYPE_COUNT] = { 0 };
+	size_t count = 0;
+	size_t mids = 0;
+	int type;
+
+	m_index = (struct sdp_media_index*)sdp_session_alloc(session,
+		sizeof(struct sdp_media_index));
+	if (!m_index)
+		goto fail;
+
+	for (media = session->media; media; media = media->next) {
+		m_index->count[media->m.type]++;
+		count++;
+
+		if (sdp_media_mid(media))
+			mids++;
+	}
+
+	slots = (struct sdp_media**)sdp_session_alloc(session,
+		(count + SDP_MEDIA_TYPE_COUNT) * sizeof(struct sdp_media*));
+	if (!slots)
+		goto fail;
+
+	for (type = 0; type < SDP_MEDIA_TYPE_COUNT; type++) {
+		m_index->type[type] = slots;
+		slots += m_index->count[type] + 1;
+	}
+
+	for (media = session->media; media; media = media->next) {
+		type = media->m.type;
+		media->slot = &m_index->type[type][fill[type]++];
+		*media->slot = media;
+	}
+
+	if (mids) {
+		/* kept at most half full */
+		for (m_index->mid_size = 2; m_index->mid_size < mids * 2;
+			m_index->mid_size <<= 1);
+
+		m_index->mid = (struct sdp_media**)sdp_session_alloc(session,
+			m_index->mid_size * sizeof(struct sdp_media*));
+		if (!m_index->mid)
+			goto fail;
+
+		for (media = session->media; media; media = media->next) {
+			const char *mid = sdp_media_mid(media);
+			struct sdp_media **slot;
+
+			if (!mid)
+				continue;
+
+			/* the first media of a tag is the one found */
+			if (!*(slot = sdp_mid_slot(m_index, mid)))
+				*slot = media;
+		}
+	}
+
+	session->m_index = m_index;
+	return SDP_PARSE_OK;
+
+fail:
+	sdperr("memory acllocation");
+	return SDP_PARSE_ERROR;
+}
+
+static enum sdp_parse_err sdp_parser_end(struct sdp_parser *p)
 {
+	enum sdp_parse_err err;
+
+	if ((err = sdp_parser_validate(p)) != SDP_PARSE_OK)
+		return err;
+
+	return sdp_media_index_build(p->session);
+}
+
+/* the session is the first allocation of its own arena */
+static struct sdp_session *sdp_session_create(void)
+{
+	struct sdp_arena *arena;
 	struct sdp_session *session;
 
-	session = (struct sdp_session*)calloc(1, sizeof(struct sdp_session));
-	if (!session)
+	if (!(arena = sdp_arena_create()))
 		return NULL;
 
-	if (!(session->sdp = sdp_stream_open(type, ctx))) {
-		free(session);
+	session = (struct sdp_session*)sdp_arena_alloc(arena,
+		sizeof(struct sdp_session));
+	if (!session) {
+		sdp_arena_destroy(arena);
 		return NULL;
 	}
 
+	session->arena = arena;
 	return session;
 }
 
-void sdp_parser_uninit(struct sdp_session *session)
+void *sdp_session_alloc(struct sdp_session *session, size_t size)
 {
-	sdp_stream_close(session->sdp);
-	free(session->s);
-	sdp_attr_free(session->a);
-	media_free(session->media);
-	free(session);
+	return sdp_arena_alloc(session->arena, size);
 }
 
-enum sdp_parse_err sdp_session_parse(struct sdp_session *session,
-		parse_attr_specific_t parse_attr_specific)
+char *sdp_session_strdup(struct sdp_session *session, const char *s)
 {
-	enum sdp_parse_err err = SDP_PARSE_ERROR;
-	char *line = NULL;
-	size_t len = 0;
-	sdp_stream_t sdp = session->sdp;
+	return sdp_arena_strdup(session->arena, s);
+}
 
-	/* parse v= */
-	if (sdp_parse_version(sdp, &line, &len, &session->v) ==
-			SDP_PARSE_ERROR) {
-		goto exit;
+size_t sdp_session_memory_usage(const struct sdp_session *session)
+{
+	size_t size = sdp_arena_size(session->arena);
+	struct sdp_parser *p = session->parser;
+
+	if (p) {
+		size += sizeof(struct sdp_parser);
+		if (p->buf) {
+			size += p->size + SDP_SCAN_PAD +
+				SDP_SCAN_WORDS(p->size) * sizeof(uint64_t);
+		}
 	}
 
-	/* skip parsing of non supported session-level descriptors */
-	if (sdp_parse_non_supported(sdp, &line, &len, "o") ==
-			SDP_PARSE_ERROR) {
-		goto exit;
+	return size;
+}
+
+struct sdp_session *sdp_parser_init(enum sdp_stream_type type, void *ctx)
+{
+	struct sdp_session *session;
+
+	if (!(session = sdp_session_create()))
+		return NULL;
+
+	if (!(session->sdp = sdp_stream_open(type, ctx))) {
+		sdp_arena_destroy(session->arena);
+		return NULL;
 	}
 
-	/* parse s= */
-	if (sdp_parse_session_name(sdp, &line, &len, &session->s) ==
-			SDP_PARSE_ERROR) {
-		goto exit;
+	return session;
+}
+
+struct sdp_session *sdp_parser_init_stream(sdp_stream_t sdp)
+{
+	struct sdp_session *session;
+
+	if (!(session = sdp_session_create()))
+		return NULL;
+
+	session->sdp = sdp;
+	session->is_sdp_borrowed = 1;
+	return session;
+}
+
+/* the parser is created on first use and kept with the session */
+static struct sdp_parser *sdp_parser_get(struct sdp_session *session)
+{
+	if (!session->parser) {
+		session->parser = (struct sdp_parser*)calloc(1,
+			sizeof(struct sdp_parser));
+		if (!session->parser)
+			sdperr("memory acllocation");
 	}
 
-	/* skip parsing of non supported session-level descriptors */
-	if (sdp_parse_non_supported(sdp, &line, &len, "iuep") ==
-			SDP_PARSE_ERROR) {
-		goto exit;
+	return session->parser;
+}
+
+static struct sdp_session *sdp_parser_push_create(
+		parse_attr_specific_t parse_attr_specific, void *ctx,
+		const struct sdp_profile *profile)
+{
+	struct sdp_session *session;
+
+	if (!(session = sdp_session_create()))
+		return NULL;
+
+	if (!sdp_parser_get(session)) {
+		sdp_arena_destroy(session->arena);
+		return NULL;
 	}
 
-	/* nothing except for (t=[v=]) is compulsory from here on */
-	if (!line) {
-		err = SDP_PARSE_OK;
-		goto exit;
+	sdp_parser_setup(session->parser, session, parse_attr_specific, ctx,
+		profile);
+	session->parser->is_fed = 1;
+	return session;
+}
+
+struct sdp_session *sdp_parser_init_push(
+		parse_attr_specific_t parse_attr_specific, void *ctx)
+{
+	return sdp_parser_push_create(parse_attr_specific, ctx, NULL);
+}
+
+struct sdp_session *sdp_parser_init_push_profile(
+		const struct sdp_profile *profile)
+{
+	return sdp_parser_push_create(NULL, NULL, profile);
+}
+
+static void sdp_parser_free(struct sdp_parser *p)
+{
+	free(p->buf);
+	free(p->bits);
+	free(p);
+}
+
+int sdp_session_reset(struct sdp_session *session, void *ctx)
+{
+	struct sdp_session tmp;
+	struct sdp_media *media;
+
+	if (ctx) {
+		if (!session->sdp || session->is_sdp_borrowed) {
+			sdperr("session stream cannot be reopened");
+			return -1;
+		}
+
+		if (sdp_stream_reopen(session->sdp, ctx))
+			return -1;
 	}
 
-	/* parse c=* */
-	if (sdp_parse_connection_information(sdp, &line, &len, &session->c) ==
-			SDP_PARSE_ERROR) {
-		goto exit;
+	sdp_attr_dtor(session->a);
+	for (media = session->media; media; media = media->next)
+		sdp_attr_dtor(media->a);
+
+	/* all but the session itself is released, its memory kept */
+	sdp_arena_reset(session->arena, session + 1);
+
+	tmp = *session;
+	memset(session, 0, sizeof(struct sdp_session));
+	session->arena = tmp.arena;
+	session->sdp = tmp.sdp;
+	session->is_sdp_borrowed = tmp.is_sdp_borrowed;
+	session->parser = tmp.parser;
+	session->is_lazy = tmp.is_lazy;
+	session->is_addr_text = tmp.is_addr_text;
+	session->is_parallel = tmp.is_parallel;
+
+	/* a push session is ready to be fed again */
+	if (!session->sdp && session->parser) {
+		sdp_parser_setup(session->parser, session,
+			session->parser->parse_attr_specific,
+			session->parser->parse_ctx, session->parser->profile);
+		session->parser->is_fed = 1;
 	}
 
-	if (!line) {
-		err = SDP_PARSE_OK;
-		goto exit;
+	return 0;
+}
+
+int sdp_session_compact(struct sdp_session *session)
+{
+	struct sdp_parser *p = session->parser;
+
+	if (p && p->is_fed) {
+		sdperr("session is being fed");
+		return -1;
 	}
 
-	/* skip parsing of non supported session-level descriptors */
-	if (sdp_parse_non_supported(sdp, &line, &len, "btvuezk") ==
-			SDP_PARSE_ERROR) {
-		goto exit;
+	if (session->sdp && !session->is_sdp_borrowed)
+		sdp_stream_close(session->sdp);
+	session->sdp = NULL;
+	session->is_sdp_borrowed = 0;
+
+	/* attributes recorded by a lazy parse are decoded with the parse
+	 * state, but indexed into a buffer of their own */
+	if (p && session->is_lazy) {
+		free(p->buf);
+		free(p->bits);
+		p->buf = NULL;
+		p->bits = NULL;
+		p->size = 0;
+		p->partial = 0;
+	} else if (p) {
+		sdp_parser_free(p);
+		session->parser = NULL;
 	}
 
-	if (!line) {
-		err = SDP_PARSE_OK;
-		goto exit;
+	sdp_arena_trim(session->arena);
+	return 0;
+}
+
+void sdp_parser_uninit(struct sdp_session *session)
+{
+	struct sdp_media *media;
+
+	if (session->sdp && !session->is_sdp_borrowed)
+		sdp_stream_close(session->sdp);
+	if (session->parser)
+		sdp_parser_free(session->parser);
+
+	sdp_attr_dtor(session->a);
+	for (media = session->media; media; media = media->next)
+		sdp_attr_dtor(media->a);
+
+	/* everything else, the session included, is released at once */
+	sdp_arena_destroy(session->arena);
+}
+
+/* sizes the flat arrays from a count of the m= and a= lines of the
+ * document, if the stream lets it be looked at beforehand */
+static int sdp_parser_flat_reserve(struct sdp_parser *p)
+{
+	struct sdp_session *session = p->session;
+	const char *buf;
+	const char *end;
+	ssize_t len;
+	size_t media = 0;
+	size_t attr = 0;
+
+	if ((len = sdp_stream_peek(&buf, session->sdp)) <= 0)
+		return 0;
+
+	for (end = buf + len; end - buf > 1; buf++) {
+		if (buf[1] == '=') {
+			if (*buf == 'm')
+				media++;
+			else if (*buf == 'a')
+				attr++;
+		}
+
+		if (!(buf = (const char*)memchr(buf, '\n', end - buf)))
+			break;
 	}
 
-	if (sdp_parse_session_level_attr(sdp, &line, &len, &session->a,
-			parse_attr_specific) == SDP_PARSE_ERROR) {
-		goto exit;
+	if (media) {
+		session->media_flat = (struct sdp_media*)sdp_session_alloc(
+			session, media * sizeof(struct sdp_media));
+		if (!session->media_flat)
+			goto fail;
+	}
+	if (attr) {
+		session->attr_flat = (struct sdp_attr*)sdp_session_alloc(
+			session, attr * sizeof(struct sdp_attr));
+		if (!session->attr_flat)
+			goto fail;
 	}
 
-	if (!line) {
-		err = SDP_PARSE_OK;
-		goto exit;
+	p->media_flat_size = media;
+	p->attr_flat_size = attr;
+	return 0;
+
+fail:
+	sdperr("memory acllocation");
+	return -1;
+}
+
+#ifdef SDP_PARSE_PARALLEL
+/* a run of lines parsed on its own, the first run holding the session
+ * header. Runs other than the first are parsed into a session of their own,
+ * whose media and arena are then taken over */
+struct sdp_parse_run {
+	struct sdp_parser *parser; /* of the session */
+	const char *start;
+	const char *end;
+	struct sdp_parser *p; /* parsing the run */
+	enum sdp_parse_err err;
+};
+
+static void sdp_parse_run_job(void *ctx, int i)
+{
+	struct sdp_parse_run *run = &((struct sdp_parse_run*)ctx)[i];
+	struct sdp_parser *p = run->parser;
+
+	if (i) {
+		struct sdp_session *session;
+
+		if (!(session = sdp_session_create()))
+			goto fail;
+
+		if (!(run->p = (struct sdp_parser*)calloc(1,
+				sizeof(struct sdp_parser)))) {
+			sdp_arena_destroy(session->arena);
+			goto fail;
+		}
+
+		session->is_lazy = p->session->is_lazy;
+		session->is_addr_text = p->session->is_addr_text;
+		sdp_parser_setup(run->p, session, p->parse_attr_specific,
+			p->parse_ctx, p->profile);
+		/* the run starts with an m= line */
+		run->p->state = SDP_PARSE_STATE_MEDIA_SKIP;
+	} else {
+		run->p = p;
 	}
 
-	/* parse media-level description */
+	sdp_parser_input_feed(run->p, run->start, run->end - run->start);
+	sdp_parser_block_feed(run->p, "", 0, 1);
 
-	do {
+	/* the block ends as it would at the next m= line */
+	run->err = sdp_parser_validate(run->p);
+	return;
+
+fail:
+	sdperr("memory acllocation");
+	run->err = SDP_PARSE_ERROR;
+}
+
+/* the media of the other runs follow those of the first one */
+static enum sdp_parse_err sdp_parse_runs_join(struct sdp_parse_run *runs,
+		size_t count)
+{
+	struct sdp_session *session = runs[0].parser->session;
+	enum sdp_parse_err err = SDP_PARSE_OK;
+	struct sdp_media **tail;
+	size_t i;
+
+	for (tail = &session->media; *tail; tail = &(*tail)->next);
+
+	for (i = 0; i < count; i++) {
+		struct sdp_parser *p = runs[i].p;
 		struct sdp_media *media;
-		struct sdp_media **next;
-		enum sdp_parse_err err;
 
-		if (sdp_parse_descriptor_type(line) != 'm')
-			goto exit;
-
-		/* add media to session */
-		for (next = &session->media; *next; next = &(*next)->next);
-		if (!(*next= (struct sdp_media*)calloc(1,
-                		sizeof(struct sdp_media)))) {
-			goto exit;
-                }
-
-		media = *next;
-
-		/* parse m= */
-		err = sdp_parse_media(sdp, &line, &len, &media->m);
-		if (err == SDP_PARSE_ERROR)
-			goto exit;
-
-		/* skip non suppored m= media blocks */
-		if (err == SDP_PARSE_NOT_SUPPORTED) {
-			while (line && sdp_parse_descriptor_type(line) != 'm')
-				sdp_getline(&line, &len, sdp);
+		if (err == SDP_PARSE_OK)
+			err = runs[i].err;
+
+		if (!i || !p)
 			continue;
+
+		*tail = p->session->media;
+		for ( ; *tail; tail = &(*tail)->next) {
+			struct sdp_attr *a;
+
+			/* decoded with the session's parser */
+			for (media = *tail, a = media->a; a; a = a->next) {
+				if (a->is_raw)
+					a->value.raw.session = session;
+			}
 		}
 
-		if (!line)
-			return SDP_PARSE_OK;
+		sdp_arena_merge(session->arena, p->session->arena);
+		sdp_parser_free(p);
+	}
 
-		/* skip parsing of non supported media-level descriptors */
-		if (sdp_parse_non_supported(sdp, &line, &len, "i") ==
-				SDP_PARSE_ERROR) {
-			goto exit;
+	return err;
+}
+
+static int sdp_line_is_blank(const char *line, const char *end)
+{
+	for ( ; line < end; line++) {
+		if (!IS_WHITESPACE_DELIM(*line))
+			return 0;
+	}
+
+	return 1;
+}
+
+/* sets the result of the parse, returns -1 if the description is to be
+ * parsed line by line instead */
+static int sdp_parser_parallel(struct sdp_parser *p, enum sdp_parse_err *err)
+{
+	struct sdp_parse_run *runs = NULL;
+	struct sdp_parse_run *tmp;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t run_media;
+	size_t count = 0;
+	size_t size = 0;
+	size_t media = 0;
+	size_t consumed;
+	const char *buf;
+	const char *line;
+	const char *next;
+	const char *end;
+	ssize_t len;
+
+	/* a single processor would only pay for the runs */
+	if (cpus < 2)
+		return -1;
+
+	if ((len = sdp_stream_peek(&buf, p->session->sdp)) <= 0)
+		return -1;
+
+	/* the description ends at an empty line */
+	for (line = buf, end = buf + len; line < end; line = next) {
+		next = (const char*)memchr(line, '\n', end - line);
+		next = next ? next + 1 : end;
+
+		if (sdp_line_is_blank(line, next)) {
+			end = line;
+			break;
 		}
-		if (!line)
-			return SDP_PARSE_OK;
 
-		/* parse c=* */
-		if (sdp_parse_connection_information(sdp, &line, &len,
-				&media->c) == SDP_PARSE_ERROR) {
-			goto exit;
+		if (next - line >= 2 && !strncmp(line, "m=", 2))
+			media++;
+	}
+	consumed = next - buf;
+
+	/* a run per processor, of no fewer media blocks than make up for
+	 * the session, parser and arena each run sets up */
+	run_media = (media + cpus - 1) / cpus;
+	if (run_media < SDP_PARSE_RUN_MEDIA_MIN)
+		run_media = SDP_PARSE_RUN_MEDIA_MIN;
+
+	/* a run starts every run_media m= lines */
+	for (line = buf, media = 0; line < end; line = next) {
+		next = (const char*)memchr(line, '\n', end - line);
+		next = next ? next + 1 : end;
+
+		if (count) {
+			if (next - line < 2 || strncmp(line, "m=", 2))
+				continue;
+
+			if (!media++ || (media - 1) % run_media)
+				continue;
 		}
-		if (!line)
-			return SDP_PARSE_OK;
 
-		/* skip parsing of non supported media-level descriptors */
-		if (sdp_parse_non_supported(sdp, &line, &len, "bk") ==
-				SDP_PARSE_ERROR) {
-			goto exit;
+		if (count == size) {
+			size = size ? size << 1 : 16;
+			if (!(tmp = (struct sdp_parse_run*)realloc(runs,
+					size * sizeof(struct sdp_parse_run)))) {
+				free(runs);
+				sdperr("memory acllocation");
+				*err = SDP_PARSE_ERROR;
+				return 0;
+			}
+			runs = tmp;
 		}
-		if (!line)
-			return SDP_PARSE_OK;
 
-		/* parse media-level a=* */
-		if (sdp_parse_media_level_attr(sdp, &line, &len, media,
-				&media->a,
-				parse_attr_specific) == SDP_PARSE_ERROR) {
-			goto exit;
+		if (count)
+			runs[count - 1].end = line;
+		memset(&runs[count], 0, sizeof(struct sdp_parse_run));
+		runs[count].parser = p;
+		runs[count].start = line;
+		count++;
+	}
+
+	if (count < 2) {
+		free(runs);
+		return -1;
+	}
+	runs[count - 1].end = end;
+
+	/* runs allocate from arenas of their own, the memory a reset kept
+	 * would only pile up with theirs */
+	sdp_arena_trim(p->session->arena);
+
+	sdp_pool_run(0, count, sdp_parse_run_job, runs);
+	p->err = sdp_parse_runs_join(runs, count);
+	free(runs);
+
+	/* consumed as by a line by line parse */
+	sdp_stream_skip(p->session->sdp, consumed);
+
+	*err = p->err == SDP_PARSE_OK ?
+		sdp_media_index_build(p->session) : p->err;
+	return 0;
+}
+#endif
+
+static enum sdp_parse_err sdp_session_parse_stream(
+		struct sdp_session *session,
+		parse_attr_specific_t parse_attr_specific, void *ctx,
+		const struct sdp_profile *profile)
+{
+	struct sdp_parser *p;
+	const char *buf;
+	ssize_t len;
+#ifdef SDP_PARSE_PARALLEL
+	enum sdp_parse_err err;
+#endif
+
+	if (!session->sdp) {
+		sdperr("session has no stream to parse");
+		return SDP_PARSE_ERROR;
+	}
+
+	if (!(p = sdp_parser_get(session)))
+		return SDP_PARSE_ERROR;
+
+	sdp_parser_setup(p, session, parse_attr_specific, ctx, profile);
+#ifdef SDP_PARSE_PARALLEL
+	if (session->is_parallel && !sdp_parser_parallel(p, &err))
+		return err;
+#endif
+	if (sdp_parser_flat_reserve(p))
+		return SDP_PARSE_ERROR;
+
+	if ((len = sdp_stream_peek(&buf, session->sdp)) >= 0) {
+		/* the stream is indexed in place of its lines */
+		do {
+			sdp_stream_skip(session->sdp,
+				sdp_parser_input_feed(p, buf, len));
+		} while (p->err == SDP_PARSE_OK && !p->is_eos &&
+			(len = sdp_stream_peek(&buf, session->sdp)) > 0);
+	} else {
+		while (p->err == SDP_PARSE_OK && !p->is_eos &&
+				(len = sdp_stream_getline_view(&buf,
+				session->sdp)) > 0) {
+			sdp_parser_input_feed(p, buf, len);
 		}
-	} while (line);
+	}
 
-	err = SDP_PARSE_OK;
-	goto exit;
+	/* the last line need not be terminated */
+	sdp_parser_block_feed(p, "", 0, 1);
+	return sdp_parser_end(p);
+}
 
-exit:
-	free(line);
-	return err;
+enum sdp_parse_err sdp_session_parse(struct sdp_session *session,
+		parse_attr_specific_t parse_attr_specific, void *ctx)
+{
+	return sdp_session_parse_stream(session, parse_attr_specific, ctx,
+		NULL);
+}
+
+enum sdp_parse_err sdp_session_parse_profile(struct sdp_session *session,
+		const struct sdp_profile *profile)
+{
+	return sdp_session_parse_stream(session, NULL, NULL, profile);
+}
+
+enum sdp_parse_err sdp_parser_feed(struct sdp_session *session,
+		const char *buf, size_t len)
+{
+	struct sdp_parser *p = session->parser;
+
+	if (!p || !p->is_fed) {
+		sdperr("session is not being fed");
+		return SDP_PARSE_ERROR;
+	}
+
+	/* a line split between chunks is held until it is complete */
+	sdp_parser_input_feed(p, buf, len);
+	return p->err;
 }
 
+enum sdp_parse_err sdp_parser_finish(struct sdp_session *session)
+{
+	struct sdp_parser *p = session->parser;
+
+	if (!p || !p->is_fed) {
+		sdperr("session is not being fed");
+		return SDP_PARSE_ERROR;
+	}
+
+	/* the last line need not be terminated */
+	sdp_parser_block_feed(p, "", 0, 1);
+
+	p->is_fed = 0;
+	return sdp_parser_end(p);
+}
+
+/* the line is composed first and written at once, lines of parses running
+ * concurrently are not interleaved */
 static void sdpout(char *level, char *fmt, va_list va)
 {
-	fprintf(stderr, "SDP parse %s - ", level);
-	vfprintf(stderr, fmt, va);
-	fprintf(stderr, "\n");
+	char line[SDP_OUT_LINE_MAX];
+	int len;
+
+	len = snprintf(line, sizeof(line), "SDP parse %s - ", level);
+	vsnprintf(line + len, sizeof(line) - len - 1, fmt, va);
+	strcat(line, "\n");
+
+	fputs(line, stderr);
 	fflush(stderr);
 }
 
@@ -1097,38 +2359,94 @@ static struct sdp_media *sdp_media_locate(struct sdp_media *media,
 struct sdp_media *sdp_media_get(struct sdp_session *session,
 		enum sdp_media_type type)
 {
-	return sdp_media_locate(session->media, type);
+	if (!session->m_index || type == SDP_MEDIA_TYPE_NONE)
+		return sdp_media_locate(session->media, type);
+
+	if ((unsigned int)type >= SDP_MEDIA_TYPE_COUNT)
+		return NULL;
+
+	return session->m_index->type[type][0];
 }
 
 struct sdp_media *sdp_media_get_next(struct sdp_media *media)
 {
-	return sdp_media_locate(media->next, media->m.type);
+	if (!media->slot)
+		return sdp_media_locate(media->next, media->m.type);
+
+	return media->slot[1];
 }
 
-static struct sdp_attr *sdp_attr_locate(struct sdp_attr *attr,
-		enum sdp_attr_type type)
+struct sdp_media *sdp_media_get_mid(struct sdp_session *session,
+		const char *mid)
 {
-	if (attr && attr->type == SDP_ATTR_NONE)
-		return attr;
+	struct sdp_media *media;
+
+	if (session->m_index) {
+		if (!session->m_index->mid)
+			return NULL;
+
+		return *sdp_mid_slot(session->m_index, mid);
+	}
+
+	for (media = session->media; media; media = media->next) {
+		const char *tag = sdp_media_mid(media);
+
+		if (tag && !strcmp(tag, mid))
+			break;
+	}
+
+	return media;
+}
+
+static struct sdp_attr *sdp_attr_index_get(struct sdp_attr *attr,
+		struct sdp_attr_index *a_index, enum sdp_attr_type type)
+{
+	if ((unsigned int)type >= SDP_ATTR_TYPE_COUNT)
+		return NULL;
 
-	for ( ; attr && attr->type != type; attr = attr->next);
-	return attr;
+	return sdp_attr_locate(attr, a_index->head[type], type);
 }
 
 struct sdp_attr *sdp_media_attr_get(struct sdp_media *media,
 		enum sdp_attr_type type)
 {
-	return sdp_attr_locate(media->a, type);
+	return sdp_attr_index_get(media->a, &media->a_index, type);
 }
 
 struct sdp_attr *sdp_session_attr_get(struct sdp_session *session,
 		enum sdp_attr_type type)
 {
-	return sdp_attr_locate(session->a, type);
+	return sdp_attr_index_get(session->a, &session->a_index, type);
+}
+
+int sdp_media_source_allowed(struct sdp_media *media,
+		enum sdp_ci_addrtype addrtype, const void *src)
+{
+	struct sdp_attr_source_filter_spec *spec;
+	struct sdp_attr *a;
+	int is_listed = 0;
+
+	if (!media->a_index.head[SDP_ATTR_SOURCE_FILTER])
+		return 1;
+
+	/* looked up by its index only, for an untyped attribute not to pass
+	 * for it. A source-filter a lazy parse cannot decode lets no source
+	 * through */
+	a = sdp_attr_locate(NULL, media->a_index.head[SDP_ATTR_SOURCE_FILTER],
+		SDP_ATTR_SOURCE_FILTER);
+	if (!a)
+		return 0;
+
+	spec = &a->value.source_filter.spec;
+	if (spec->src_table && addrtype == spec->addrtype)
+		is_listed = *sdp_source_filter_slot(spec, src) != NULL;
+
+	return a->value.source_filter.mode == SDP_ATTR_SRC_FLT_INCL ?
+		is_listed : !is_listed;
 }
 
 struct sdp_attr *sdp_attr_get_next(struct sdp_attr *attr)
 {
-	return sdp_attr_locate(attr->next, attr->type);
+	return sdp_attr_locate(attr->next, attr->next_type, attr->type);
 }
 
@@ -3,6 +3,12 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#if defined(_WIN32)
+#include <Winsock2.h>
+#include <Ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#endif
 
 #include "sdp_stream.h"
 
@@ -43,13 +49,24 @@ enum sdp_ci_addrtype {
 	SDP_CI_ADDRTYPE_NOT_SUPPORTED,
 };
 
+/* an address as addrtype tells, in network byte order. Domain names and
+ * the source-filter "*" are not resolved and only held as text */
+struct sdp_addr {
+	union {
+		struct in_addr ip4;
+		struct in6_addr ip6;
+	} u;
+	int is_name;
+};
+
  /* c=<nettype> <addrtype> <connection-address> */
 struct sdp_connection_information {
 	enum sdp_ci_nettype nettype;
 	enum sdp_ci_addrtype addrtype;
-	char sdp_ci_addr[256];
-	int sdp_ci_ttl;
-	int count;
+	struct sdp_addr addr;
+	char *sdp_ci_addr; /* text, see is_addr_text */
+	int sdp_ci_ttl; /* IP4 multicast */
+	int count; /* number of addresses, 0 without c= */
 };
 
 /* media description */
@@ -64,6 +81,8 @@ enum sdp_media_type {
 	SDP_MEDIA_TYPE_NOT_SUPPORTED,
 };
 
+#define SDP_MEDIA_TYPE_COUNT (SDP_MEDIA_TYPE_NOT_SUPPORTED + 1)
+
 enum sdp_media_proto {
 	SDP_MEDIA_PROTO_RTP_NONE,
 	SDP_MEDIA_PROTO_RTP_AVP,
@@ -97,6 +116,8 @@ enum sdp_attr_type {
       SDP_ATTR_NOT_SUPPORTED,
 };
 
+#define SDP_ATTR_TYPE_COUNT (SDP_ATTR_NOT_SUPPORTED + 1)
+
 struct group_identification_tag {
 	char *identification_tag;
 	struct group_identification_tag *next;
@@ -112,7 +133,7 @@ struct sdp_attr_value_group {
 /* a=rtpmap:<val> <subytype>/<clock>[/<channel>] */
 struct sdp_attr_value_rtpmap {
 	int fmt;
-	char media_subtype[64];
+	char *media_subtype;
 	int clock_rate;
     int num_channel;
 };
@@ -121,7 +142,7 @@ struct sdp_attr_value_rtpmap {
 struct sdp_attr_value_fmtp {
 	int fmt;
 	void *params;
-	void (*param_dtor)(void *params);
+	void (*param_dtor)(void *params); /* if not allocated from session */
 };
 
 enum sdp_attr_source_filter_mode {
@@ -130,16 +151,21 @@ enum sdp_attr_source_filter_mode {
 };
 
 struct source_filter_src_addr {
-	char addr[256];
+	struct sdp_addr src;
+	char *addr; /* text, see is_addr_text */
 	struct source_filter_src_addr *next;
 };
 
 struct sdp_attr_source_filter_spec {
 	enum sdp_ci_nettype nettype;
 	enum sdp_ci_addrtype addrtype;
-	char dst_addr[256];
+	struct sdp_addr dst;
+	char *dst_addr; /* text, see is_addr_text */
 	struct source_filter_src_addr src_list;
 	int src_list_len;
+	/* the binary sources by address, see sdp_media_source_allowed() */
+	struct source_filter_src_addr **src_table;
+	size_t src_table_size;
 };
 
 /* a=source-filter:<filter-mode> <filter-spec> */
@@ -153,6 +179,13 @@ struct sdp_attr_value_mid {
 	char *identification_tag;
 };
 
+/* an attribute recorded by a lazy parse, until it is first looked for */
+struct sdp_attr_value_raw {
+	char *line; /* the attribute line past its a= */
+	struct sdp_session *session;
+	struct sdp_media *media; /* NULL at the session level */
+};
+
 union sdp_attr_value {
 	/* Common */
 
@@ -167,12 +200,35 @@ union sdp_attr_value {
 
 	/* Specific */
 	void *specific;
+
+	/* Lazy, see is_lazy */
+	struct sdp_attr_value_raw raw;
 };
 
 struct sdp_attr {
 	enum sdp_attr_type type;
+	int is_raw; /* recorded but not decoded yet, value is raw */
 	union sdp_attr_value value;
 	struct sdp_attr *next;
+	struct sdp_attr *next_type; /* next of the same type, see below */
+};
+
+/* Indexes
+ * The attributes of each level are indexed by type as they are parsed, and
+ * the media of the session by type and by a=mid once it is parsed, for the
+ * accessors to be constant time */
+struct sdp_attr_index {
+	unsigned int mask; /* a bit per attribute type present */
+	struct sdp_attr *head[SDP_ATTR_TYPE_COUNT]; /* first of each type */
+};
+
+struct sdp_media;
+
+struct sdp_media_index {
+	struct sdp_media **type[SDP_MEDIA_TYPE_COUNT]; /* NULL terminated */
+	size_t count[SDP_MEDIA_TYPE_COUNT];
+	struct sdp_media **mid; /* open addressed on a=mid */
+	size_t mid_size;
 };
 
 struct sdp_media {
@@ -196,11 +252,24 @@ struct sdp_media {
 	 */
 
 	struct sdp_attr *a; /* a=* */
+	struct sdp_attr_index a_index;
+	size_t a_offset; /* of a in the flat attributes of the session */
+	size_t a_count;
 	struct sdp_media *next;
+	struct sdp_media **slot; /* in the media index, NULL until indexed */
 };
 
+struct sdp_parser;
+struct sdp_arena;
+
 struct sdp_session {
+	struct sdp_arena *arena; /* backs everything the session holds */
 	sdp_stream_t sdp;
+	int is_sdp_borrowed; /* stream is not closed with the session */
+	struct sdp_parser *parser; /* parse state, kept for reuse */
+	int is_lazy; /* set before parsing, see below */
+	int is_addr_text; /* set before parsing to keep addresses as text */
+	int is_parallel; /* set before parsing, see below */
 
 	struct sdp_session_v v; /* v= */
 
@@ -234,6 +303,8 @@ struct sdp_session {
 	*/
 
 	   struct sdp_attr *a;
+	struct sdp_attr_index a_index;
+	size_t a_count; /* a leads the flat attributes */
 
 	/* not supported
 	   =============
@@ -246,16 +317,190 @@ struct sdp_session {
 	 */
 
 	struct sdp_media *media; /* media-level descriptor(s) */
+	struct sdp_media_index *m_index; /* NULL until parsed */
+
+	/* Flat layout
+	 * Streams the whole document of which can be looked at beforehand,
+	 * see sdp_stream_peek(), have their m= and a= lines counted before
+	 * parsing. Media and attributes are then allocated from two arrays,
+	 * in document order, for readers to walk them sequentially:
+	 *
+	 *   for (i = 0; i < session->media_count; i++) {
+	 *           struct sdp_media *media = &session->media_flat[i];
+	 *           struct sdp_attr *a = session->attr_flat + media->a_offset;
+	 *
+	 *           for (j = 0; j < media->a_count; j++)
+	 *                   ... a[j] ...
+	 *   }
+	 *
+	 * The lists and the accessors remain, over the same nodes. The arrays
+	 * are NULL for FILE and push sessions, and those parsed in parallel */
+	struct sdp_media *media_flat;
+	size_t media_count;
+	struct sdp_attr *attr_flat;
+	size_t attr_count;
 };
 
-typedef enum sdp_parse_err (*parse_attr_specific_t)(struct sdp_media *media,
-	struct sdp_attr *a, char *attr, char *value, char *params);
+/* specific parsers allocate what they attach to the attribute from the
+ * session, see sdp_session_alloc(). ctx is the one passed along with the
+ * parser to sdp_session_parse() or sdp_parser_init_push(), state a parser
+ * keeps across attributes belongs there for parses to run concurrently */
+typedef enum sdp_parse_err (*parse_attr_specific_t)(
+	struct sdp_session *session, struct sdp_media *media,
+	struct sdp_attr *a, char *attr, char *value, char *params, void *ctx);
+
+/* Attribute parser profiles
+ * A profile maps attribute names, at the session level or for a media type,
+ * to parsers of their own, each with a context pointer. Profiles are
+ * composed by registering the parsers of several of them (ST2110-20,
+ * ST2110-30...) into the same profile, a later registration of an
+ * attribute replacing an earlier one.
+ *
+ * For attributes the parser supports itself, group and the fmtp parameters
+ * are handed to the registered parser, if any. Other attributes are handed
+ * whole to their registered parser, their type set to SDP_ATTR_SPECIFIC.
+ *
+ * A profile is built once, registration is not thread safe. Once built it
+ * is only read while parsing and may be shared by any number of threads. */
+struct sdp_profile;
+
+/* media is NULL at the session level */
+typedef enum sdp_parse_err (*sdp_attr_parser_t)(struct sdp_session *session,
+	struct sdp_media *media, struct sdp_attr *a, char *attr, char *value,
+	char *params, void *ctx);
+
+struct sdp_profile *sdp_profile_create(void);
+void sdp_profile_destroy(struct sdp_profile *profile);
+
+/** Register an attribute parser
+ * @param profile    profile to register with.
+ * @param attr       attribute name.
+ * @param type       media type, SDP_MEDIA_TYPE_NONE for the session level.
+ * @param parser     parser of the attribute.
+ * @param ctx        passed on to the parser.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int sdp_profile_register(struct sdp_profile *profile, const char *attr,
+		enum sdp_media_type type, sdp_attr_parser_t parser, void *ctx);
 
 struct sdp_session *sdp_parser_init(enum sdp_stream_type type, void *ctx);
+/* parse the current document of a stream opened by the caller, who closes it.
+ * Lets a multi-document stream be parsed into a session per document */
+struct sdp_session *sdp_parser_init_stream(sdp_stream_t sdp);
 void sdp_parser_uninit(struct sdp_session *session);
 
+/** Reuse a session for another description
+ * Releases what the session holds but keeps its memory, its stream and its
+ * parse state, so that parsing over and over with the same session stops
+ * allocating once it has grown to fit the descriptions parsed. A push
+ * session is ready to be fed again.
+ *
+ * @param session    session to reset.
+ * @param ctx        new input of the session's stream, as passed to
+ *                   sdp_parser_init(), see sdp_stream_reopen(). NULL keeps
+ *                   the stream as it is, as for a borrowed stream moved on
+ *                   to its next document or for a push session.
+ *
+ * @return 0 on success, -1 otherwise, the session being left as it was.
+ */
+int sdp_session_reset(struct sdp_session *session, void *ctx);
+
+/* Session memory
+ * Everything a session holds is allocated from the session's own arena, as
+ * a handful of bump allocations, and released with it at once by
+ * sdp_parser_uninit(). Allocations are zero initialized */
+void *sdp_session_alloc(struct sdp_session *session, size_t size);
+char *sdp_session_strdup(struct sdp_session *session, const char *s);
+
+/* bytes of memory the session holds, its arena and its parse state. Neither
+ * the stream nor attribute parameters released through a param_dtor are
+ * accounted for */
+size_t sdp_session_memory_usage(const struct sdp_session *session);
+
+/** Release what a parsed session only holds for parsing
+ * Frees the parser's line buffer, structural index and state, closes the
+ * session's stream or lets go of a borrowed one, and releases the arena
+ * chunks kept by sdp_session_reset(). What remains is the parsed
+ * description, as for sessions kept resident once parsed. A lazy session
+ * keeps the parse state its attributes are decoded with.
+ *
+ * A compacted session is read and released with sdp_parser_uninit(), it
+ * can no longer be reopened, fed or parsed.
+ *
+ * @param session    session to compact.
+ *
+ * @return 0 on success, -1 for a push session still being fed.
+ */
+int sdp_session_compact(struct sdp_session *session);
+
+/* Sessions are independent of each other, any number of them may be parsed
+ * at once by as many threads, the parser keeping no state outside of the
+ * session. Diagnostics are written a whole line at a time.
+ *
+ * The stream is read through line views, or a block at a time where it can
+ * be peeked at, and each block copied into the parser's buffer: fields are
+ * null-terminated in place, and the stream's storage is never written to */
 enum sdp_parse_err sdp_session_parse(struct sdp_session *session,
-		parse_attr_specific_t parse_attr_specific);
+		parse_attr_specific_t parse_attr_specific, void *ctx);
+/* parse with the attribute parsers of a profile */
+enum sdp_parse_err sdp_session_parse_profile(struct sdp_session *session,
+		const struct sdp_profile *profile);
+
+/* Addresses
+ * The addresses of c= lines and source-filters are parsed into their binary
+ * form, see struct sdp_addr. Their text is only kept, allocated from the
+ * session, with is_addr_text set on the session before it is parsed, or for
+ * domain names */
+
+/* Lazy parsing
+ * With is_lazy set on the session before it is parsed, attributes are only
+ * recorded, their type and raw line, and decoded the first time an accessor
+ * looks for their type. The cost of a description is then that of the
+ * attributes actually read. Multiple instances of an attribute are still
+ * rejected while parsing, other errors in the value of an attribute are
+ * reported once it is decoded, its type being set to
+ * SDP_ATTR_NOT_SUPPORTED.
+ *
+ * Decoding modifies the session, lazy sessions are not to be read by
+ * several threads at once. The parse_attr_specific callback and its ctx, or
+ * the profile, are used when decoding and have to outlive the session. Code
+ * walking the attribute lists itself sees recorded attributes with is_raw
+ * set */
+
+/* Parallel parsing
+ * With is_parallel set on the session before it is parsed, a description
+ * which can be looked at as a whole, see sdp_stream_peek(), is split at its
+ * m= lines into a run of media blocks per online processor. The runs are
+ * parsed by a pool of threads, the first run along with the session header,
+ * and the media chained back together in document order. Each run costs a
+ * session, a parser and an arena of its own, runs are therefore of a few
+ * dozen media blocks at least. Descriptions of fewer media blocks, on a
+ * single processor, or on other streams and platforms, are parsed as usual.
+ *
+ * A description parsed in parallel is not laid out flat: media_flat and
+ * attr_flat are NULL and media and attributes are only reached through the
+ * lists and the accessors.
+ *
+ * The parse_attr_specific callback and its ctx, or the profile, are called
+ * from several threads at once. Media level parsers are handed a session of
+ * their own while parsing, which they allocate from but which holds nothing
+ * else. Should several media blocks be in error, each one is reported, the
+ * first one setting the result */
+
+/* push mode: the description is fed in arbitrary chunks as it arrives, e.g.
+ * from a non blocking socket, parsing resumes where the previous chunk left
+ * off. A line split between chunks is held until its end is fed. Parsing
+ * stops at the first error, or at an empty line which ends the description.
+ * sdp_parser_finish() parses a last unterminated line and validates the
+ * description is complete */
+struct sdp_session *sdp_parser_init_push(
+		parse_attr_specific_t parse_attr_specific, void *ctx);
+struct sdp_session *sdp_parser_init_push_profile(
+		const struct sdp_profile *profile);
+enum sdp_parse_err sdp_parser_feed(struct sdp_session *session,
+		const char *buf, size_t len);
+enum sdp_parse_err sdp_parser_finish(struct sdp_session *session);
 
 void sdpwarn(char *fmt, ...);
 void sdperr(char *fmt, ...);
@@ -266,6 +511,10 @@ struct sdp_media *sdp_media_get(struct sdp_session *session,
 
 struct sdp_media *sdp_media_get_next(struct sdp_media *media);
 
+/* the media of the given a=mid identification tag */
+struct sdp_media *sdp_media_get_mid(struct sdp_session *session,
+		const char *mid);
+
 struct sdp_attr *sdp_media_attr_get(struct sdp_media *media,
 		enum sdp_attr_type type);
 
@@ -274,6 +523,13 @@ struct sdp_attr *sdp_session_attr_get(struct sdp_session *session,
 
 struct sdp_attr *sdp_attr_get_next(struct sdp_attr *attr);
 
+/* whether the source-filter of the media lets packets from src through,
+ * in constant time. src is a struct in_addr or struct in6_addr as addrtype
+ * tells. Media without a source-filter let any source through, media whose
+ * source-filter a lazy parse fails to decode none */
+int sdp_media_source_allowed(struct sdp_media *media,
+		enum sdp_ci_addrtype addrtype, const void *src);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sdp_pool.h"
+
+#define POOL_LINE 64 /* queues are kept on cache lines of their own */
+
+#define POOL_RANGE(_begin_, _end_) \
+	((uint64_t)(_end_) << 32 | (uint32_t)(_begin_))
+#define POOL_BEGIN(_range_) ((int)(uint32_t)(_range_))
+#define POOL_END(_range_) ((int)((_range_) >> 32))
+
+/* the jobs [begin, end) left to a worker, packed for both ends to be
+ * updated at once */
+struct sdp_pool_queue {
+	uint64_t range;
+	char pad[POOL_LINE - sizeof(uint64_t)];
+};
+
+struct sdp_pool {
+	sdp_pool_job_t job;
+	void *ctx;
+	int threads;
+	struct sdp_pool_queue *queues;
+};
+
+struct sdp_pool_worker {
+	struct sdp_pool *pool;
+	int id;
+	pthread_t tid;
+};
+
+/* the owner takes jobs from the front of its queue */
+static int sdp_pool_pop(struct sdp_pool_queue *q)
+{
+	uint64_t range = __atomic_load_n(&q->range, __ATOMIC_ACQUIRE);
+
+	while (POOL_BEGIN(range) < POOL_END(range)) {
+		if (__atomic_compare_exchange_n(&q->range, &range,
+				POOL_RANGE(POOL_BEGIN(range) + 1,
+				POOL_END(range)), 0, __ATOMIC_ACQ_REL,
+				__ATOMIC_ACQUIRE)) {
+			return POOL_BEGIN(range);
+		}
+	}
+
+	return -1;
+}
+
+/* an idle worker takes the back half of another's queue. Returns 0 once
+ * every queue has been found empty */
+static int sdp_pool_steal(struct sdp_pool *pool, int id)
+{
+	int i;
+
+	for (i = 1; i < pool->threads; i++) {
+		struct sdp_pool_queue *victim =
+			&pool->queues[(id + i) % pool->threads];
+		uint64_t range = __atomic_load_n(&victim->range,
+			__ATOMIC_ACQUIRE);
+
+		while (POOL_BEGIN(range) < POOL_END(range)) {
+			int begin = POOL_BEGIN(range);
+			int mid = begin + (POOL_END(range) - begin) / 2;
+
+			if (__atomic_compare_exchange_n(&victim->range, &range,
+					POOL_RANGE(begin, mid), 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				__atomic_store_n(&pool->queues[id].range,
+					POOL_RANGE(mid, POOL_END(range)),
+					__ATOMIC_RELEASE);
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void *sdp_pool_worker(void *arg)
+{
+	struct sdp_pool_worker *w = (struct sdp_pool_worker*)arg;
+	struct sdp_pool *pool = w->pool;
+
+	do {
+		int i;
+
+		while ((i = sdp_pool_pop(&pool->queues[w->id])) != -1)
+			pool->job(pool->ctx, i);
+	} while (sdp_pool_steal(pool, w->id));
+
+	return NULL;
+}
+
+int sdp_pool_run(int threads, int n, sdp_pool_job_t job, void *ctx)
+{
+	struct sdp_pool pool = { job, ctx, 0, NULL };
+	struct sdp_pool_worker *workers;
+	int started;
+	int i;
+
+	if (threads <= 0)
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < threads)
+		threads = n;
+	if (threads < 1)
+		threads = 1;
+
+	pool.queues = (struct sdp_pool_queue*)calloc(threads,
+		sizeof(struct sdp_pool_queue));
+	workers = (struct sdp_pool_worker*)calloc(threads,
+		sizeof(struct sdp_pool_worker));
+	if (!pool.queues || !workers) {
+		free(pool.queues);
+		free(workers);
+		for (i = 0; i < n; i++)
+			job(ctx, i);
+		return 1;
+	}
+
+	/* jobs are dealt out evenly and rebalanced by stealing as they turn
+	 * out to take more or less time */
+	pool.threads = threads;
+	for (i = 0; i < threads; i++) {
+		pool.queues[i].range = POOL_RANGE((int64_t)n * i / threads,
+			(int64_t)n * (i + 1) / threads);
+		workers[i].pool = &pool;
+		workers[i].id = i;
+	}
+
+	/* failing to start a worker only leaves its jobs to be stolen */
+	for (started = 0; started < threads - 1; started++) {
+		if (pthread_create(&workers[started + 1].tid, NULL,
+				sdp_pool_worker, &workers[started + 1])) {
+			break;
+		}
+	}
+
+	sdp_pool_worker(&workers[0]);
+
+	for (i = 0; i < started; i++)
+		pthread_join(workers[i + 1].tid, NULL);
+	free(workers);
+	free(pool.queues);
+
+	return started + 1;
+}
@@ -0,0 +1,29 @@
+#ifndef _SDP_POOL_H_
+#define _SDP_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Thread pool running a batch of independent jobs
+ *
+ * Workers, the calling thread among them, are each dealt an even share of
+ * the job indexes and run them in order. A worker done with its share steals
+ * the back half of another's, so that jobs of uneven cost keep every worker
+ * busy until all n have been run. */
+
+typedef void (*sdp_pool_job_t)(void *ctx, int i);
+
+/** Run job(ctx, i) for every i in [0, n)
+ * @param threads    number of threads running jobs, the calling thread
+ *                   included. 0 for one per online processor.
+ *
+ * @return once all jobs have been run, the number of threads that ran them.
+ */
+int sdp_pool_run(int threads, int n, sdp_pool_job_t job, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
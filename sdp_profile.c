@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sdp_profile.h"
+
+#define PROFILE_SIZE_MIN 16 /* slots, a power of 2 */
+
+#define FNV1A_OFFSET 14695981039346656037ULL
+#define FNV1A_PRIME 1099511628211ULL
+
+/* an open addressed table, kept at most half full */
+struct sdp_profile {
+	struct sdp_profile_entry *entries;
+	size_t size;
+	size_t count;
+};
+
+static size_t profile_hash(const char *attr, size_t len,
+		enum sdp_media_type type)
+{
+	uint64_t h = FNV1A_OFFSET;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ (uint8_t)attr[i]) * FNV1A_PRIME;
+	h = (h ^ (uint8_t)type) * FNV1A_PRIME;
+
+	return (size_t)h;
+}
+
+static struct sdp_profile_entry *profile_slot(
+		struct sdp_profile_entry *entries, size_t size,
+		const char *attr, size_t len, enum sdp_media_type type)
+{
+	size_t i = profile_hash(attr, len, type) & (size - 1);
+
+	/* linear probing, there is always a free slot */
+	for ( ; entries[i].attr; i = (i + 1) & (size - 1)) {
+		if (entries[i].type == type && entries[i].len == len &&
+				!memcmp(entries[i].attr, attr, len)) {
+			break;
+		}
+	}
+
+	return &entries[i];
+}
+
+static int profile_grow(struct sdp_profile *profile)
+{
+	struct sdp_profile_entry *entries;
+	size_t size = profile->size << 1;
+	size_t i;
+
+	entries = (struct sdp_profile_entry*)calloc(size,
+		sizeof(struct sdp_profile_entry));
+	if (!entries)
+		return -1;
+
+	for (i = 0; i < profile->size; i++) {
+		struct sdp_profile_entry *e = &profile->entries[i];
+
+		if (e->attr)
+			*profile_slot(entries, size, e->attr, e->len,
+				e->type) = *e;
+	}
+
+	free(profile->entries);
+	profile->entries = entries;
+	profile->size = size;
+	return 0;
+}
+
+struct sdp_profile *sdp_profile_create(void)
+{
+	struct sdp_profile *profile;
+
+	profile = (struct sdp_profile*)calloc(1, sizeof(struct sdp_profile));
+	if (!profile)
+		return NULL;
+
+	profile->size = PROFILE_SIZE_MIN;
+	profile->entries = (struct sdp_profile_entry*)calloc(profile->size,
+		sizeof(struct sdp_profile_entry));
+	if (!profile->entries) {
+		free(profile);
+		return NULL;
+	}
+
+	return profile;
+}
+
+void sdp_profile_destroy(struct sdp_profile *profile)
+{
+	size_t i;
+
+	for (i = 0; i < profile->size; i++)
+		free(profile->entries[i].attr);
+	free(profile->entries);
+	free(profile);
+}
+
+int sdp_profile_register(struct sdp_profile *profile, const char *attr,
+		enum sdp_media_type type, sdp_attr_parser_t parser, void *ctx)
+{
+	struct sdp_profile_entry *e;
+	size_t len = strlen(attr);
+
+	if (!len || !parser)
+		return -1;
+
+	if (profile->size < (profile->count + 1) * 2 && profile_grow(profile))
+		return -1;
+
+	e = profile_slot(profile->entries, profile->size, attr, len, type);
+	if (!e->attr) {
+		if (!(e->attr = (char*)malloc(len + 1)))
+			return -1;
+
+		memcpy(e->attr, attr, len + 1);
+		e->len = len;
+		e->type = type;
+		profile->count++;
+	}
+
+	/* a later registration replaces an earlier one */
+	e->parser = parser;
+	e->ctx = ctx;
+	return 0;
+}
+
+const struct sdp_profile_entry *sdp_profile_lookup(
+		const struct sdp_profile *profile, const char *attr, size_t len,
+		enum sdp_media_type type)
+{
+	struct sdp_profile_entry *e;
+
+	e = profile_slot(profile->entries, profile->size, attr, len, type);
+	return e->attr ? e : NULL;
+}
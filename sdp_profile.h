@@ -0,0 +1,30 @@
+#ifndef _SDP_PROFILE_H_
+#define _SDP_PROFILE_H_
+
+#include "sdp_parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Profile internals, see sdp_profile_create() */
+
+struct sdp_profile_entry {
+	char *attr; /* NULL for a free slot */
+	size_t len;
+	enum sdp_media_type type;
+	sdp_attr_parser_t parser;
+	void *ctx;
+};
+
+/* the parser registered for the attribute at a session (SDP_MEDIA_TYPE_NONE)
+ * or media level, NULL if there is none. Does not modify the profile */
+const struct sdp_profile_entry *sdp_profile_lookup(
+		const struct sdp_profile *profile, const char *attr, size_t len,
+		enum sdp_media_type type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
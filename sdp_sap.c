@@ -0,0 +1,349 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdp_sap.h"
+
+#define SAP_VERSION 1
+#define SAP_HDR_LEN 4
+#define SAP_HDR_VERSION(_b_) ((_b_) >> 5)
+#define SAP_HDR_A (1 << 4) /* address type, IPv6 originating source */
+#define SAP_HDR_T (1 << 2) /* message type, deletion */
+#define SAP_HDR_E (1 << 1) /* encrypted payload */
+#define SAP_HDR_C (1 << 0) /* compressed payload */
+
+#define SAP_PAYLOAD_TYPE "application/sdp"
+#define SAP_BUCKETS_MIN 64
+
+#define FNV1A_OFFSET 14695981039346656037ULL
+#define FNV1A_PRIME 1099511628211ULL
+
+struct sap_entry {
+	struct sdp_sap_announcement a;
+	uint64_t digest; /* payload digest, compared under a zero hash */
+	struct sap_entry *next;
+};
+
+struct sdp_sap {
+	sdp_stream_t sdp;
+	parse_attr_specific_t parse_attr_specific;
+	void *ctx; /* of parse_attr_specific */
+	struct sap_entry **buckets;
+	size_t nbuckets; /* power of 2 */
+	size_t nentries;
+	struct sap_entry *deleted; /* kept until the next receive */
+};
+
+static uint64_t fnv1a(uint64_t h, const void *buf, size_t len)
+{
+	const uint8_t *p = (const uint8_t*)buf;
+
+	while (len--)
+		h = (h ^ *p++) * FNV1A_PRIME;
+
+	return h;
+}
+
+static size_t sap_key_hash(int is_ipv6, const uint8_t *source,
+		uint16_t msg_id_hash)
+{
+	uint64_t h;
+
+	h = fnv1a(FNV1A_OFFSET, source, is_ipv6 ? 16 : 4);
+	h = fnv1a(h, &msg_id_hash, sizeof(msg_id_hash));
+	return (size_t)h;
+}
+
+static struct sap_entry **sap_entry_locate(struct sdp_sap *sap, int is_ipv6,
+		const uint8_t *source, uint16_t msg_id_hash)
+{
+	struct sap_entry **e;
+
+	e = &sap->buckets[sap_key_hash(is_ipv6, source, msg_id_hash) &
+		(sap->nbuckets - 1)];
+	for ( ; *e; e = &(*e)->next) {
+		if ((*e)->a.is_ipv6 == is_ipv6 &&
+				(*e)->a.msg_id_hash == msg_id_hash &&
+				!memcmp((*e)->a.source, source,
+					is_ipv6 ? 16 : 4)) {
+			break;
+		}
+	}
+
+	return e;
+}
+
+static int sap_grow(struct sdp_sap *sap)
+{
+	struct sap_entry **buckets;
+	size_t nbuckets = sap->nbuckets << 1;
+	size_t i;
+
+	buckets = (struct sap_entry**)calloc(nbuckets,
+		sizeof(struct sap_entry*));
+	if (!buckets)
+		return -1;
+
+	for (i = 0; i < sap->nbuckets; i++) {
+		struct sap_entry *e;
+
+		while ((e = sap->buckets[i])) {
+			size_t b = sap_key_hash(e->a.is_ipv6, e->a.source,
+				e->a.msg_id_hash) & (nbuckets - 1);
+
+			sap->buckets[i] = e->next;
+			e->next = buckets[b];
+			buckets[b] = e;
+		}
+	}
+
+	free(sap->buckets);
+	sap->buckets = buckets;
+	sap->nbuckets = nbuckets;
+	return 0;
+}
+
+static void sap_entry_free(struct sap_entry *e)
+{
+	if (e->a.session)
+		sdp_parser_uninit(e->a.session);
+	free(e);
+}
+
+/* parses the rest of the current datagram into the entry's session */
+static void sap_entry_parse(struct sdp_sap *sap, struct sap_entry *e)
+{
+	if (e->a.session) {
+		sdp_parser_uninit(e->a.session);
+		e->a.session = NULL;
+	}
+
+	e->a.err = SDP_PARSE_ERROR;
+	if (!(e->a.session = sdp_parser_init_stream(sap->sdp)))
+		return;
+
+	e->a.err = sdp_session_parse(e->a.session, sap->parse_attr_specific,
+		sap->ctx);
+	if (e->a.err != SDP_PARSE_OK) {
+		sdp_parser_uninit(e->a.session);
+		e->a.session = NULL;
+		return;
+	}
+
+	/* cached past the datagram, whose stream moves on */
+	sdp_session_compact(e->a.session);
+}
+
+/* returns the length of the SAP header, payload type included, 0 if the
+ * packet is to be ignored */
+static size_t sap_header_parse(const uint8_t *buf, size_t len, int *is_ipv6,
+		int *is_deletion, uint16_t *msg_id_hash, const uint8_t **source)
+{
+	size_t hdr_len;
+	const char *payload;
+	const char *type_end;
+
+	if (len < SAP_HDR_LEN || SAP_HDR_VERSION(buf[0]) != SAP_VERSION)
+		return 0;
+
+	if (buf[0] & (SAP_HDR_E | SAP_HDR_C)) {
+		sdpwarn("SAP encrypted/compressed payload not supported");
+		return 0;
+	}
+
+	*is_ipv6 = buf[0] & SAP_HDR_A ? 1 : 0;
+	*is_deletion = buf[0] & SAP_HDR_T ? 1 : 0;
+	*msg_id_hash = (uint16_t)(buf[2] << 8 | buf[3]);
+	*source = buf + SAP_HDR_LEN;
+
+	/* header, originating source, authentication data */
+	hdr_len = SAP_HDR_LEN + (*is_ipv6 ? 16 : 4) + buf[1] * 4;
+	if (len < hdr_len)
+		return 0;
+
+	/* a deletion is identified by its key alone */
+	if (*is_deletion)
+		return hdr_len;
+
+	/* the optional payload type is omitted if the payload is a bare SDP */
+	payload = (const char*)buf + hdr_len;
+	if (len - hdr_len < 3 || strncmp(payload, "v=0", 3)) {
+		type_end = (const char*)memchr(payload, 0, len - hdr_len);
+		if (!type_end || strcmp(payload, SAP_PAYLOAD_TYPE))
+			return 0;
+
+		hdr_len += type_end + 1 - payload;
+	}
+
+	return hdr_len;
+}
+
+int sdp_sap_recv(sdp_sap_t sap_listener,
+		struct sdp_sap_announcement **announcement)
+{
+	struct sdp_sap *sap = (struct sdp_sap*)sap_listener;
+
+	if (sap->deleted) {
+		sap_entry_free(sap->deleted);
+		sap->deleted = NULL;
+	}
+
+	for (;;) {
+		struct sap_entry **e;
+		const char *buf;
+		ssize_t len;
+		size_t hdr_len;
+		int is_ipv6;
+		int is_deletion;
+		uint16_t msg_id_hash;
+		const uint8_t *source;
+		uint64_t digest = 0;
+
+		/* release the previous datagram */
+		sdp_stream_next(sap->sdp);
+
+		if ((len = sdp_stream_peek(&buf, sap->sdp)) < 0)
+			return -1;
+
+		if (!(hdr_len = sap_header_parse((const uint8_t*)buf, len,
+				&is_ipv6, &is_deletion, &msg_id_hash,
+				&source))) {
+			continue;
+		}
+
+		e = sap_entry_locate(sap, is_ipv6, source, msg_id_hash);
+
+		if (is_deletion) {
+			struct sap_entry *deleted = *e;
+
+			if (!deleted)
+				continue;
+
+			*e = deleted->next;
+			sap->nentries--;
+			deleted->a.event = SDP_SAP_EVENT_DELETE;
+			deleted->a.last_seen = time(NULL);
+			sap->deleted = deleted;
+			*announcement = &deleted->a;
+			return 0;
+		}
+
+		/* a zero hash does not identify the payload version, the
+		 * payload itself has to be compared */
+		if (!msg_id_hash)
+			digest = fnv1a(FNV1A_OFFSET, buf + hdr_len,
+				len - hdr_len);
+
+		if (sdp_stream_skip(sap->sdp, hdr_len))
+			continue;
+
+		if (*e) {
+			if ((*e)->digest == digest) {
+				(*e)->a.event = SDP_SAP_EVENT_REPEAT;
+			} else {
+				(*e)->a.event = SDP_SAP_EVENT_CHANGED;
+				(*e)->digest = digest;
+				sap_entry_parse(sap, *e);
+			}
+		} else {
+			if (sap->nbuckets < sap->nentries + 1 && !sap_grow(sap))
+				e = sap_entry_locate(sap, is_ipv6, source,
+					msg_id_hash);
+
+			if (!(*e = (struct sap_entry*)calloc(1,
+					sizeof(struct sap_entry)))) {
+				sdperr("memory allocation");
+				return -1;
+			}
+
+			(*e)->a.event = SDP_SAP_EVENT_NEW;
+			(*e)->a.is_ipv6 = is_ipv6;
+			memcpy((*e)->a.source, source, is_ipv6 ? 16 : 4);
+			(*e)->a.msg_id_hash = msg_id_hash;
+			(*e)->digest = digest;
+			sap->nentries++;
+			sap_entry_parse(sap, *e);
+		}
+
+		(*e)->a.last_seen = time(NULL);
+		*announcement = &(*e)->a;
+		return 0;
+	}
+}
+
+int sdp_sap_expire(sdp_sap_t sap_listener, time_t not_seen_since)
+{
+	struct sdp_sap *sap = (struct sdp_sap*)sap_listener;
+	int expired = 0;
+	size_t i;
+
+	for (i = 0; i < sap->nbuckets; i++) {
+		struct sap_entry **e = &sap->buckets[i];
+
+		while (*e) {
+			struct sap_entry *tmp = *e;
+
+			if (not_seen_since <= tmp->a.last_seen) {
+				e = &tmp->next;
+				continue;
+			}
+
+			*e = tmp->next;
+			sap_entry_free(tmp);
+			sap->nentries--;
+			expired++;
+		}
+	}
+
+	return expired;
+}
+
+sdp_sap_t sdp_sap_init(int fd, parse_attr_specific_t parse_attr_specific,
+		void *ctx)
+{
+	struct sdp_sap *sap;
+	struct sdp_stream_usck usck = { fd, 0, 0 };
+
+	sap = (struct sdp_sap*)calloc(1, sizeof(struct sdp_sap));
+	if (!sap)
+		return NULL;
+
+	sap->nbuckets = SAP_BUCKETS_MIN;
+	sap->buckets = (struct sap_entry**)calloc(sap->nbuckets,
+		sizeof(struct sap_entry*));
+	if (!sap->buckets) {
+		free(sap);
+		return NULL;
+	}
+
+	if (!(sap->sdp = sdp_stream_open(SDP_STREAM_TYPE_USCK, &usck))) {
+		free(sap->buckets);
+		free(sap);
+		return NULL;
+	}
+
+	sap->parse_attr_specific = parse_attr_specific;
+	sap->ctx = ctx;
+	return (sdp_sap_t)sap;
+}
+
+void sdp_sap_uninit(sdp_sap_t sap_listener)
+{
+	struct sdp_sap *sap = (struct sdp_sap*)sap_listener;
+	size_t i;
+
+	for (i = 0; i < sap->nbuckets; i++) {
+		struct sap_entry *e;
+
+		while ((e = sap->buckets[i])) {
+			sap->buckets[i] = e->next;
+			sap_entry_free(e);
+		}
+	}
+
+	if (sap->deleted)
+		sap_entry_free(sap->deleted);
+
+	sdp_stream_close(sap->sdp);
+	free(sap->buckets);
+	free(sap);
+}
@@ -0,0 +1,72 @@
+#ifndef _SDP_SAP_H_
+#define _SDP_SAP_H_
+
+#include <stdint.h>
+#include <time.h>
+#include "sdp_parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Session Announcement Protocol (RFC 2974) listener
+ *
+ * Announcements are received through a USCK stream and keyed by their
+ * originating source and message identifier hash. A description is parsed
+ * only the first time its key is seen (or when its payload changes under a
+ * zero hash), repeats are answered from the cache. */
+
+enum sdp_sap_event {
+	SDP_SAP_EVENT_NEW, /* first announcement of a session */
+	SDP_SAP_EVENT_CHANGED, /* payload changed under the same key */
+	SDP_SAP_EVENT_REPEAT, /* re-announcement, served from the cache */
+	SDP_SAP_EVENT_DELETE, /* explicit deletion of a session */
+};
+
+struct sdp_sap_announcement {
+	enum sdp_sap_event event;
+	int is_ipv6; /* address family of source */
+	uint8_t source[16]; /* originating source, network order */
+	uint16_t msg_id_hash;
+	enum sdp_parse_err err; /* result of parsing the description */
+	struct sdp_session *session; /* NULL if parsing failed */
+	time_t last_seen;
+};
+
+typedef void *sdp_sap_t;
+
+/** Create a SAP listener
+ * @param fd         Bound datagram socket (joined to the SAP group by the
+ *                   caller), remains owned by the caller.
+ * @param parse_attr_specific Specific attribute parser passed on to
+ *                   sdp_session_parse().
+ * @param ctx        passed on to parse_attr_specific.
+ *
+ * @return a listener on success, NULL otherwise.
+ */
+sdp_sap_t sdp_sap_init(int fd, parse_attr_specific_t parse_attr_specific,
+		void *ctx);
+void sdp_sap_uninit(sdp_sap_t sap);
+
+/** Receive the next SAP announcement
+ * Blocks until an announcement is received. Packets which are not SAP
+ * version 1, or are encrypted or compressed, are skipped.
+ *
+ * The announcement and its session belong to the cache, the session
+ * compacted, see sdp_session_compact(). Those of a deleted session remain
+ * valid until the next call.
+ *
+ * @return 0 on success, -1 on receive error.
+ */
+int sdp_sap_recv(sdp_sap_t sap, struct sdp_sap_announcement **announcement);
+
+/** Drop cached announcements not seen since the given time
+ * @return number of announcements dropped.
+ */
+int sdp_sap_expire(sdp_sap_t sap, time_t not_seen_since);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,290 @@
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+/* AVX2 is selected at run time, the code being built for it regardless of
+ * the target */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "sdp_scan.h"
+
+#define SCAN_BLOCK 64 /* characters per bitmap word */
+
+#if defined(_MSC_VER)
+static int scan_ctz(uint64_t w)
+{
+	unsigned long i;
+
+	_BitScanForward64(&i, w);
+	return (int)i;
+}
+#else
+#define scan_ctz(_w_) __builtin_ctzll(_w_)
+#endif
+
+#define SCAN_STRUCTURAL 1
+#define SCAN_BREAK 2
+
+/* a block of 64 characters is indexed by a word of its structural
+ * characters followed by a word of its line breaks */
+typedef void (*scan_index_t)(const char *buf, size_t blocks,
+	uint64_t *bits);
+
+#if !defined(SCAN_SSE2)
+static const unsigned char scan_class[256] = {
+	['\0'] = SCAN_STRUCTURAL, [' '] = SCAN_STRUCTURAL,
+	['/'] = SCAN_STRUCTURAL, [':'] = SCAN_STRUCTURAL,
+	[';'] = SCAN_STRUCTURAL, ['='] = SCAN_STRUCTURAL,
+	['\t'] = SCAN_STRUCTURAL, ['\r'] = SCAN_STRUCTURAL,
+	['\n'] = SCAN_STRUCTURAL | SCAN_BREAK,
+};
+
+static void scan_index_scalar(const char *buf, size_t blocks,
+		uint64_t *bits)
+{
+	size_t i;
+
+	for (i = 0; i < blocks; i++, buf += SCAN_BLOCK) {
+		uint64_t w = 0;
+		uint64_t nl = 0;
+		int j;
+
+		for (j = 0; j < SCAN_BLOCK; j++) {
+			unsigned char c = scan_class[(unsigned char)buf[j]];
+
+			w |= (uint64_t)(c & SCAN_STRUCTURAL) << j;
+			nl |= (uint64_t)(c >> 1) << j;
+		}
+
+		*bits++ = w;
+		*bits++ = nl;
+	}
+}
+#endif
+
+#ifdef SCAN_SSE2
+static void scan_index_sse2(const char *buf, size_t blocks, uint64_t *bits)
+{
+	const __m128i sp = _mm_set1_epi8(' ');
+	const __m128i slash = _mm_set1_epi8('/');
+	const __m128i colon = _mm_set1_epi8(':');
+	const __m128i semicolon = _mm_set1_epi8(';');
+	const __m128i eq = _mm_set1_epi8('=');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i nul = _mm_setzero_si128();
+	size_t i;
+
+	for (i = 0; i < blocks; i++) {
+		uint64_t w = 0;
+		uint64_t nl = 0;
+		int j;
+
+		for (j = 0; j < SCAN_BLOCK; j += 16, buf += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)buf);
+			__m128i n = _mm_cmpeq_epi8(v, lf);
+			__m128i m;
+
+			m = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(v, sp),
+					_mm_cmpeq_epi8(v, slash)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, colon),
+					_mm_cmpeq_epi8(v, semicolon)));
+			m = _mm_or_si128(m, _mm_or_si128(
+				_mm_cmpeq_epi8(v, eq), _mm_cmpeq_epi8(v, nul)));
+			m = _mm_or_si128(m, _mm_or_si128(n,
+				_mm_or_si128(_mm_cmpeq_epi8(v, tab),
+				_mm_cmpeq_epi8(v, cr))));
+
+			w |= (uint64_t)(unsigned int)_mm_movemask_epi8(m) << j;
+			nl |= (uint64_t)(unsigned int)_mm_movemask_epi8(n) << j;
+		}
+
+		*bits++ = w;
+		*bits++ = nl;
+	}
+}
+#endif
+
+#ifdef SCAN_AVX2
+__attribute__((target("avx2")))
+static void scan_index_avx2(const char *buf, size_t blocks, uint64_t *bits)
+{
+	const __m256i sp = _mm256_set1_epi8(' ');
+	const __m256i slash = _mm256_set1_epi8('/');
+	const __m256i colon = _mm256_set1_epi8(':');
+	const __m256i semicolon = _mm256_set1_epi8(';');
+	const __m256i eq = _mm256_set1_epi8('=');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	const __m256i nul = _mm256_setzero_si256();
+	size_t i;
+
+	for (i = 0; i < blocks; i++) {
+		uint64_t w = 0;
+		uint64_t nl = 0;
+		int j;
+
+		for (j = 0; j < SCAN_BLOCK; j += 32, buf += 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)buf);
+			__m256i n = _mm256_cmpeq_epi8(v, lf);
+			__m256i m;
+
+			m = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, sp),
+					_mm256_cmpeq_epi8(v, slash)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, colon),
+					_mm256_cmpeq_epi8(v, semicolon)));
+			m = _mm256_or_si256(m, _mm256_or_si256(
+				_mm256_cmpeq_epi8(v, eq),
+				_mm256_cmpeq_epi8(v, nul)));
+			m = _mm256_or_si256(m, _mm256_or_si256(n,
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, tab),
+				_mm256_cmpeq_epi8(v, cr))));
+
+			w |= (uint64_t)(unsigned int)_mm256_movemask_epi8(m) <<
+				j;
+			nl |= (uint64_t)(unsigned int)_mm256_movemask_epi8(n) <<
+				j;
+		}
+
+		*bits++ = w;
+		*bits++ = nl;
+	}
+}
+#endif
+
+/* the widest kernel the target has, AVX2 being looked for once at load
+ * time rather than on every buffer */
+#if defined(SCAN_SSE2)
+static scan_index_t scan_index = scan_index_sse2;
+#else
+static scan_index_t scan_index = scan_index_scalar;
+#endif
+
+#ifdef SCAN_AVX2
+__attribute__((constructor))
+static void scan_init(void)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		scan_index = scan_index_avx2;
+}
+#endif
+
+void sdp_scan_index(struct sdp_scan *scan, char *buf, size_t len,
+		uint64_t *bits)
+{
+	size_t words = SDP_SCAN_WORDS(len);
+	size_t tail = (len + 1) % SCAN_BLOCK;
+
+	scan_index(buf, words / 2, bits);
+
+	/* whatever lies past the terminating '\0' is not part of the
+	 * buffer */
+	if (tail) {
+		bits[words - 2] &= ((uint64_t)1 << tail) - 1;
+		bits[words - 1] &= ((uint64_t)1 << tail) - 1;
+	}
+
+	scan->buf = buf;
+	scan->end = buf + len;
+	scan->bits = bits;
+	sdp_scan_line(scan, buf);
+}
+
+char *sdp_scan_eol(struct sdp_scan *scan, char *line)
+{
+	size_t offset = line - scan->buf;
+	size_t word = offset / SCAN_BLOCK;
+	size_t last = (scan->end - scan->buf) / SCAN_BLOCK;
+	uint64_t w;
+
+	w = scan->bits[2 * word + 1] & (~(uint64_t)0 << (offset % SCAN_BLOCK));
+	while (!w) {
+		if (++word > last)
+			return scan->end;
+
+		w = scan->bits[2 * word + 1];
+	}
+
+	return scan->buf + word * SCAN_BLOCK + scan_ctz(w);
+}
+
+void sdp_scan_line(struct sdp_scan *scan, char *line)
+{
+	scan->line = line;
+	scan->pos = line;
+	scan->delim = 0;
+	scan->len = 0;
+}
+
+/* delimiter sets are a character or two, not worth a call to strchr() */
+static inline int scan_is_delim(const char *delim, char c)
+{
+	for ( ; *delim; delim++) {
+		if (*delim == c)
+			return 1;
+	}
+
+	return 0;
+}
+
+char *sdp_scan_token(struct sdp_scan *scan, char *str, const char *delim)
+{
+	char *token = str ? str : scan->pos;
+	char *end;
+	size_t word;
+	size_t offset;
+	uint64_t w;
+
+	/* skip leading delimiters */
+	while (*token && scan_is_delim(delim, *token))
+		token++;
+
+	if (!*token) {
+		scan->pos = token;
+		scan->delim = 0;
+		scan->len = 0;
+		return NULL;
+	}
+
+	/* the token ends at the first structural character that is one of
+	 * the delimiters, or at the end of the line */
+	offset = token - scan->buf;
+	word = offset / SCAN_BLOCK;
+	w = scan->bits[2 * word] & (~(uint64_t)0 << (offset % SCAN_BLOCK));
+	for (;;) {
+		if (!w) {
+			w = scan->bits[2 * ++word];
+			continue;
+		}
+
+		end = scan->buf + word * SCAN_BLOCK + scan_ctz(w);
+		if (!*end || scan_is_delim(delim, *end))
+			break;
+
+		w &= w - 1;
+	}
+
+	scan->delim = *end;
+	scan->len = end - token;
+	if (*end)
+		*end++ = 0;
+	scan->pos = end;
+
+	return token;
+}
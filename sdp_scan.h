@@ -0,0 +1,60 @@
+#ifndef _SDP_SCAN_H_
+#define _SDP_SCAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Structural scanner
+ *
+ * A buffer of lines is tokenized in two stages. The first classifies the
+ * bytes of the whole buffer at once, 32 or 16 at a time where AVX2 or SSE2
+ * are available, into a bitmap of its structural characters: ' ', '/',
+ * ':', ';', '=', the whitespaces ending lines and the terminating '\0', and
+ * a bitmap of its line breaks. Lines are split off the buffer by walking the
+ * line breaks, and tokens off each line by walking the structural
+ * characters, rather than testing every character against its
+ * delimiters. */
+
+/* bitmap words indexing a buffer of len characters, a structural and a line
+ * break word per 64 characters */
+#define SDP_SCAN_WORDS(_len_) (2 * (((_len_) + 1 + 63) / 64))
+/* the first stage reads whole blocks, past the end of the buffer. The
+ * buffer is to have this many bytes available after its terminating '\0' */
+#define SDP_SCAN_PAD 64
+
+struct sdp_scan {
+	char *buf; /* the indexed buffer */
+	char *end; /* its terminating '\0' */
+	uint64_t *bits; /* a bit per structural character and line break */
+	char *line; /* the line being tokenized */
+	char *pos; /* where tokenizing resumes, as the saveptr of strtok_r() */
+	char delim; /* delimiter ending the last token, 0 at end of line */
+	size_t len; /* length of the last token */
+};
+
+/* first stage, buf is null-terminated at len. The first line of the buffer
+ * is the one tokenized */
+void sdp_scan_index(struct sdp_scan *scan, char *buf, size_t len,
+		uint64_t *bits);
+
+/* the line break ending the line starting at line, the end of the buffer if
+ * the line is not terminated */
+char *sdp_scan_eol(struct sdp_scan *scan, char *line);
+
+/* moves tokenizing on to the line starting at line, null-terminated within
+ * the buffer over one of its structural characters */
+void sdp_scan_line(struct sdp_scan *scan, char *line);
+
+/* second stage, a strtok_r() over the indexed line: the token starting at
+ * str, or where the previous one left off if str is NULL */
+char *sdp_scan_token(struct sdp_scan *scan, char *str, const char *delim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
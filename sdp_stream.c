@@ -1,12 +1,35 @@
+#if defined(__linux__)
+#define _GNU_SOURCE /* recvmmsg */
+#endif
+
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#endif
 
 #include "sdp_stream.h"
 
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
+#endif
+
 struct sdp_stream {
 	void *ctx;
-	enum sdp_stream_type type;
+	const struct sdp_stream_ops *ops;
+};
+
+struct file_stream {
+	FILE *f;
+	char *line; /* backs line views, grows as needed */
+	size_t size;
 };
 
 struct buf_stream {
@@ -14,117 +37,784 @@ struct buf_stream {
 	size_t offset;
 };
 
+struct span_stream {
+	const char *buf;
+	size_t len;
+	size_t offset;
+};
+
+#if defined(__linux__)
+#define USCK_BATCH_DEFAULT 16
+#define USCK_BUF_SIZE_DEFAULT 8192
+
+struct usck_stream {
+	int fd;
+	unsigned int batch;
+	size_t buf_size;
+	char *pool; /* batch buffers of buf_size each */
+	struct mmsghdr *msgs;
+	struct iovec *iovs;
+	unsigned int received; /* datagrams held in the pool */
+	unsigned int cur; /* datagram currently being read */
+	struct span_stream dgram;
+};
+#endif
+
+/* copy a line view out to a getline(3) style caller buffer */
+static ssize_t sdp_stream_line_copy(char **lineptr, size_t *n,
+		const char *line, ssize_t len)
+{
+	size_t size; /* realloc allocation size */
+
+	if (!n || len <= 0)
+		return -1;
+
+	size = len + 1;
+	if (!*lineptr || *n < size) {
+		char *ptr = (char*)realloc(*lineptr, size);
+
+		if (!ptr)
+			return -1;
+
+		*n = size;
+		*lineptr = ptr;
+	}
+
+	memcpy(*lineptr, line, len);
+	(*lineptr)[len] = 0;
+	return len;
+}
+
 /* File stream */
-static int sdp_stream_open_file(struct sdp_stream *stream, char *path)
+static int sdp_stream_open_file(void **stream_ctx, void *ctx)
 {
-	FILE *f;
+	char *path = (char*)ctx;
+	struct file_stream *fs;
+
+	if (!(fs = (struct file_stream*)calloc(1, sizeof(struct file_stream))))
+		return -1;
 
-	if (!(f = fopen(path, "r")))
+	if (!(fs->f = fopen(path, "r"))) {
+		free(fs);
 		return -1;
+	}
 
-	stream->ctx = f;
-	stream->type = SDP_STREAM_TYPE_FILE;
+	*stream_ctx = fs;
 	return 0;
 }
 
-static int sdp_stream_close_file(FILE *f)
+static int sdp_stream_close_file(void *stream_ctx)
 {
-	return fclose(f);
+	struct file_stream *fs = (struct file_stream*)stream_ctx;
+	int ret;
+
+	ret = fclose(fs->f);
+	free(fs->line);
+	free(fs);
+	return ret;
 }
 
-static ssize_t sdp_stream_getline_file(char **lineptr, size_t *n, FILE *f)
+static ssize_t sdp_stream_getline_view_file(const char **line,
+		void *stream_ctx)
 {
-	return getline(lineptr, n, f);
+	struct file_stream *fs = (struct file_stream*)stream_ctx;
+	ssize_t ret;
+
+	if ((ret = getline(&fs->line, &fs->size, fs->f)) == -1)
+		return feof(fs->f) ? 0 : -1;
+
+	*line = fs->line;
+	return ret;
 }
 
+static const struct sdp_stream_ops sdp_stream_ops_file = {
+	sdp_stream_open_file,
+	sdp_stream_close_file,
+	sdp_stream_getline_view_file,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+};
+
 /* Character stream */
-static int sdp_stream_open_char(struct sdp_stream *stream, char *buf)
+static int sdp_stream_open_char(void **stream_ctx, void *ctx)
 {
 	struct buf_stream *bs;
 
 	if (!(bs = (struct buf_stream*)calloc(1, sizeof(struct buf_stream))))
 		return -1;
 
-	bs->buf = buf;
+	bs->buf = (char*)ctx;
 	bs->offset = 0;
 
-	stream->ctx = bs;
-	stream->type = SDP_STREAM_TYPE_CHAR;
+	*stream_ctx = bs;
 	return 0;
 }
 
-static int sdp_stream_close_char(struct buf_stream *bs)
+static int sdp_stream_reopen_char(void *stream_ctx, void *ctx)
 {
-	free(bs);
+	struct buf_stream *bs = (struct buf_stream*)stream_ctx;
+
+	bs->buf = (char*)ctx;
+	bs->offset = 0;
+	return 0;
+}
+
+static int sdp_stream_close_char(void *stream_ctx)
+{
+	free(stream_ctx);
 	return 0;
 }
 
-static ssize_t sdp_stream_getline_char(char **lineptr, size_t *n,
-		struct buf_stream *bs)
+static ssize_t sdp_stream_getline_view_char(const char **line,
+		void *stream_ctx)
 {
+	struct buf_stream *bs = (struct buf_stream*)stream_ctx;
 	char *buf = bs->buf + bs->offset;
 	char *next_line;
-	size_t len; /* length of string returned */
-	size_t size; /* realloc allocation size */
+	size_t len; /* length of line returned */
 
 	if (!(next_line = strchr(buf, '\n'))) {
 		size_t len_to_eof = strlen(buf);
 
 		if (!len_to_eof)
-			return -1;
+			return 0;
 
 		next_line = buf + len_to_eof;
 	} else {
 		next_line++;
 	}
 
-	if (!n)
+	len = next_line - buf;
+	*line = buf;
+	bs->offset += len;
+	return len;
+}
+
+static ssize_t sdp_stream_peek_char(const char **buf, void *stream_ctx)
+{
+	struct buf_stream *bs = (struct buf_stream*)stream_ctx;
+
+	*buf = bs->buf + bs->offset;
+	return strlen(*buf);
+}
+
+static int sdp_stream_skip_char(void *stream_ctx, size_t n)
+{
+	struct buf_stream *bs = (struct buf_stream*)stream_ctx;
+
+	if (strnlen(bs->buf + bs->offset, n) < n)
 		return -1;
 
-	len = next_line - buf;
-	size = len + 1;
-	if (!*lineptr || *n < size) {
-		char *ptr = (char*)realloc(*lineptr, size);
+	bs->offset += n;
+	return 0;
+}
 
-		if (!ptr)
+static const struct sdp_stream_ops sdp_stream_ops_char = {
+	sdp_stream_open_char,
+	sdp_stream_close_char,
+	sdp_stream_getline_view_char,
+	NULL,
+	sdp_stream_peek_char,
+	sdp_stream_skip_char,
+	sdp_stream_reopen_char,
+};
+
+/* Length bounded buffer stream */
+static int sdp_stream_open_buf(void **stream_ctx, void *ctx)
+{
+	struct sdp_stream_buf *buf = (struct sdp_stream_buf*)ctx;
+	struct span_stream *ss;
+
+	if (!buf || (!buf->buf && buf->len))
+		return -1;
+
+	if (!(ss = (struct span_stream*)calloc(1, sizeof(struct span_stream))))
+		return -1;
+
+	ss->buf = buf->buf;
+	ss->len = buf->len;
+	ss->offset = 0;
+
+	*stream_ctx = ss;
+	return 0;
+}
+
+static int sdp_stream_reopen_buf(void *stream_ctx, void *ctx)
+{
+	struct sdp_stream_buf *buf = (struct sdp_stream_buf*)ctx;
+	struct span_stream *ss = (struct span_stream*)stream_ctx;
+
+	if (!buf || (!buf->buf && buf->len))
+		return -1;
+
+	ss->buf = buf->buf;
+	ss->len = buf->len;
+	ss->offset = 0;
+	return 0;
+}
+
+static int sdp_stream_close_buf(void *stream_ctx)
+{
+	free(stream_ctx);
+	return 0;
+}
+
+static ssize_t sdp_stream_getline_view_span(const char **line,
+		void *stream_ctx)
+{
+	struct span_stream *ss = (struct span_stream*)stream_ctx;
+	const char *buf = ss->buf + ss->offset;
+	const char *next_line;
+	size_t len_to_eof = ss->len - ss->offset;
+	size_t len;
+
+	if (!len_to_eof)
+		return 0;
+
+	/* never look past the end of the span, it need not be terminated */
+	if ((next_line = (const char*)memchr(buf, '\n', len_to_eof)))
+		len = next_line + 1 - buf;
+	else
+		len = len_to_eof;
+
+	*line = buf;
+	ss->offset += len;
+	return len;
+}
+
+static ssize_t sdp_stream_peek_span(const char **buf, void *stream_ctx)
+{
+	struct span_stream *ss = (struct span_stream*)stream_ctx;
+
+	*buf = ss->buf + ss->offset;
+	return ss->len - ss->offset;
+}
+
+static int sdp_stream_skip_span(void *stream_ctx, size_t n)
+{
+	struct span_stream *ss = (struct span_stream*)stream_ctx;
+
+	if (ss->len - ss->offset < n)
+		return -1;
+
+	ss->offset += n;
+	return 0;
+}
+
+static const struct sdp_stream_ops sdp_stream_ops_buf = {
+	sdp_stream_open_buf,
+	sdp_stream_close_buf,
+	sdp_stream_getline_view_span,
+	NULL,
+	sdp_stream_peek_span,
+	sdp_stream_skip_span,
+	sdp_stream_reopen_buf,
+};
+
+/* Memory mapped file stream */
+#if defined(__linux__)
+/* map a regular file read only into a span */
+static int sdp_stream_map(struct span_stream *ms, char *path)
+{
+	char *map = NULL;
+	struct stat st;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+		goto fail;
+
+	/* an empty file cannot be mapped, it is simply an empty stream */
+	if (st.st_size) {
+		map = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd,
+			0);
+		if (map == MAP_FAILED)
+			goto fail;
+
+		/* lines are consumed once, front to back */
+		madvise(map, st.st_size, MADV_SEQUENTIAL);
+	}
+
+	/* the mapping holds its own reference to the file */
+	close(fd);
+
+	ms->buf = map;
+	ms->len = st.st_size;
+	ms->offset = 0;
+	return 0;
+
+fail:
+	close(fd);
+	return -1;
+}
+
+static int sdp_stream_unmap(struct span_stream *ms)
+{
+	if (!ms->buf)
+		return 0;
+
+	return munmap((void*)ms->buf, ms->len);
+}
+
+static int sdp_stream_open_mmap(void **stream_ctx, void *ctx)
+{
+	struct span_stream *ms;
+
+	if (!(ms = (struct span_stream*)calloc(1, sizeof(struct span_stream))))
+		return -1;
+
+	if (sdp_stream_map(ms, (char*)ctx)) {
+		free(ms);
+		return -1;
+	}
+
+	*stream_ctx = ms;
+	return 0;
+}
+
+/* the new file is mapped before the current one is let go of */
+static int sdp_stream_reopen_mmap(void *stream_ctx, void *ctx)
+{
+	struct span_stream *ms = (struct span_stream*)stream_ctx;
+	struct span_stream map;
+
+	if (sdp_stream_map(&map, (char*)ctx))
+		return -1;
+
+	sdp_stream_unmap(ms);
+	*ms = map;
+	return 0;
+}
+
+static int sdp_stream_close_mmap(void *stream_ctx)
+{
+	struct span_stream *ms = (struct span_stream*)stream_ctx;
+	int ret;
+
+	ret = sdp_stream_unmap(ms);
+	free(ms);
+	return ret;
+}
+
+static const struct sdp_stream_ops sdp_stream_ops_mmap = {
+	sdp_stream_open_mmap,
+	sdp_stream_close_mmap,
+	sdp_stream_getline_view_span,
+	NULL,
+	sdp_stream_peek_span,
+	sdp_stream_skip_span,
+	sdp_stream_reopen_mmap,
+};
+#endif
+
+/* Bundle stream */
+#if defined(__linux__)
+#define TAR_BLOCK 512
+#define TAR_SIZE_OFFSET 124
+#define TAR_SIZE_LEN 12
+#define TAR_TYPEFLAG_OFFSET 156
+#define TAR_MAGIC_OFFSET 257
+#define TAR_MAGIC "ustar"
+
+struct bundle_stream {
+	struct span_stream map; /* the whole bundle */
+	int is_tar;
+	size_t tar_next; /* header of the next archive member */
+	size_t member_end; /* end of the member being split */
+	size_t pos; /* where to look for the next document */
+	struct span_stream doc; /* current document */
+};
+
+/* move to the next regular file member of the archive, the whole bundle is
+ * a single member if it is not an archive */
+static int sdp_stream_member_next_bundle(struct bundle_stream *bs)
+{
+	const char *buf = bs->map.buf;
+	size_t len = bs->map.len;
+
+	if (!bs->is_tar) {
+		if (bs->member_end == len)
 			return -1;
 
-		*n = size;
-		*lineptr = ptr;
+		bs->pos = 0;
+		bs->member_end = len;
+		return 0;
 	}
 
-	memcpy(*lineptr, buf, len);
-	(*lineptr)[len] = 0;
-	bs->offset += len;
-	return len;
+	while (bs->tar_next + TAR_BLOCK <= len) {
+		const char *hdr = buf + bs->tar_next;
+		char size_field[TAR_SIZE_LEN + 1];
+		unsigned long long size;
+		size_t data = bs->tar_next + TAR_BLOCK;
+		char *endptr;
+
+		/* the archive ends with zero blocks */
+		if (!*hdr)
+			return -1;
+
+		memcpy(size_field, hdr + TAR_SIZE_OFFSET, TAR_SIZE_LEN);
+		size_field[TAR_SIZE_LEN] = 0;
+		size = strtoull(size_field, &endptr, 8);
+		if (endptr == size_field || len - data < size)
+			return -1;
+
+		/* member data is padded to a whole block */
+		bs->tar_next = data + (size + TAR_BLOCK - 1) /
+			TAR_BLOCK * TAR_BLOCK;
+
+		/* skip directories, links and extended headers */
+		if (hdr[TAR_TYPEFLAG_OFFSET] != '0' &&
+				hdr[TAR_TYPEFLAG_OFFSET] != '\0') {
+			continue;
+		}
+
+		bs->pos = data;
+		bs->member_end = data + size;
+		return 0;
+	}
+
+	return -1;
 }
 
+/* offset of the first line starting with v= within [from, to), to if none */
+static size_t sdp_stream_find_version_bundle(const char *buf, size_t from,
+		size_t to)
+{
+	const char *v;
+
+	if (to - from < 2)
+		return to;
+
+	if (!strncmp(buf + from, "v=", 2))
+		return from;
+
+	if (!(v = (const char*)memmem(buf + from, to - from, "\nv=", 3)))
+		return to;
+
+	return v + 1 - buf;
+}
+
+static int sdp_stream_doc_next_bundle(struct bundle_stream *bs)
+{
+	size_t start;
+	size_t end;
+
+	for (;;) {
+		start = sdp_stream_find_version_bundle(bs->map.buf, bs->pos,
+			bs->member_end);
+		if (start < bs->member_end)
+			break;
+
+		if (sdp_stream_member_next_bundle(bs)) {
+			memset(&bs->doc, 0, sizeof(struct span_stream));
+			return -1;
+		}
+	}
+
+	/* a document runs up to the version line of the next one */
+	end = sdp_stream_find_version_bundle(bs->map.buf, start + 1,
+		bs->member_end);
+
+	bs->doc.buf = bs->map.buf + start;
+	bs->doc.len = end - start;
+	bs->doc.offset = 0;
+	bs->pos = end;
+	return 0;
+}
+
+static int sdp_stream_open_bundle(void **stream_ctx, void *ctx)
+{
+	struct bundle_stream *bs;
+
+	if (!(bs = (struct bundle_stream*)calloc(1,
+			sizeof(struct bundle_stream)))) {
+		return -1;
+	}
+
+	if (sdp_stream_map(&bs->map, (char*)ctx)) {
+		free(bs);
+		return -1;
+	}
+
+	bs->is_tar = TAR_MAGIC_OFFSET + strlen(TAR_MAGIC) <= bs->map.len &&
+		!memcmp(bs->map.buf + TAR_MAGIC_OFFSET, TAR_MAGIC,
+			strlen(TAR_MAGIC));
+
+	/* an empty bundle is an empty document */
+	if (!sdp_stream_member_next_bundle(bs))
+		sdp_stream_doc_next_bundle(bs);
+
+	*stream_ctx = bs;
+	return 0;
+}
+
+static int sdp_stream_close_bundle(void *stream_ctx)
+{
+	struct bundle_stream *bs = (struct bundle_stream*)stream_ctx;
+	int ret;
+
+	ret = sdp_stream_unmap(&bs->map);
+	free(bs);
+	return ret;
+}
+
+static ssize_t sdp_stream_getline_view_bundle(const char **line,
+		void *stream_ctx)
+{
+	struct bundle_stream *bs = (struct bundle_stream*)stream_ctx;
+
+	return sdp_stream_getline_view_span(line, &bs->doc);
+}
+
+static ssize_t sdp_stream_peek_bundle(const char **buf, void *stream_ctx)
+{
+	struct bundle_stream *bs = (struct bundle_stream*)stream_ctx;
+
+	return sdp_stream_peek_span(buf, &bs->doc);
+}
+
+static int sdp_stream_skip_bundle(void *stream_ctx, size_t n)
+{
+	struct bundle_stream *bs = (struct bundle_stream*)stream_ctx;
+
+	return sdp_stream_skip_span(&bs->doc, n);
+}
+
+static int sdp_stream_next_bundle(void *stream_ctx)
+{
+	struct bundle_stream *bs = (struct bundle_stream*)stream_ctx;
+
+	/* the mapping is read in a single pass, documents are never
+	 * revisited */
+	if (!bs->doc.buf)
+		return -1;
+
+	return sdp_stream_doc_next_bundle(bs);
+}
+
+static const struct sdp_stream_ops sdp_stream_ops_bundle = {
+	sdp_stream_open_bundle,
+	sdp_stream_close_bundle,
+	sdp_stream_getline_view_bundle,
+	sdp_stream_next_bundle,
+	sdp_stream_peek_bundle,
+	sdp_stream_skip_bundle,
+	NULL,
+};
+#endif
+
 /* Network stream */
+#if defined(__linux__)
+static int sdp_stream_open_usck(void **stream_ctx, void *ctx)
+{
+	struct sdp_stream_usck *usck = (struct sdp_stream_usck*)ctx;
+	struct usck_stream *us;
+	unsigned int batch;
+	size_t buf_size;
+	unsigned int i;
+
+	if (!usck || usck->fd < 0)
+		return -1;
+
+	batch = usck->batch ? usck->batch : USCK_BATCH_DEFAULT;
+	buf_size = usck->buf_size ? usck->buf_size : USCK_BUF_SIZE_DEFAULT;
+
+	/* the pool holds batch buffers of buf_size bytes */
+	if (batch > SIZE_MAX / buf_size)
+		return -1;
+
+	if (!(us = (struct usck_stream*)calloc(1, sizeof(struct usck_stream))))
+		return -1;
+
+	us->fd = usck->fd;
+	us->batch = batch;
+	us->buf_size = buf_size;
+
+	/* the pool is set up once, receiving never allocates */
+	us->pool = (char*)malloc(us->batch * us->buf_size);
+	us->msgs = (struct mmsghdr*)calloc(us->batch, sizeof(struct mmsghdr));
+	us->iovs = (struct iovec*)calloc(us->batch, sizeof(struct iovec));
+	if (!us->pool || !us->msgs || !us->iovs) {
+		free(us->pool);
+		free(us->msgs);
+		free(us->iovs);
+		free(us);
+		return -1;
+	}
+
+	for (i = 0; i < us->batch; i++) {
+		us->iovs[i].iov_base = us->pool + i * us->buf_size;
+		us->iovs[i].iov_len = us->buf_size;
+		us->msgs[i].msg_hdr.msg_iov = &us->iovs[i];
+		us->msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	*stream_ctx = us;
+	return 0;
+}
+
+static int sdp_stream_close_usck(void *stream_ctx)
+{
+	struct usck_stream *us = (struct usck_stream*)stream_ctx;
+
+	/* the socket belongs to the caller */
+	free(us->pool);
+	free(us->msgs);
+	free(us->iovs);
+	free(us);
+	return 0;
+}
+
+/* refill the pool with as many datagrams as are pending, blocking for the
+ * first one only */
+static int sdp_stream_recv_usck(struct usck_stream *us)
+{
+	int ret;
+
+	do {
+		ret = recvmmsg(us->fd, us->msgs, us->batch, MSG_WAITFORONE,
+			NULL);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret <= 0)
+		return -1;
+
+	us->received = ret;
+	us->cur = 0;
+	return 0;
+}
+
+static int sdp_stream_load_usck(struct usck_stream *us)
+{
+	struct mmsghdr *msg;
+
+	for (;;) {
+		if (us->received <= us->cur && sdp_stream_recv_usck(us))
+			return -1;
+
+		msg = &us->msgs[us->cur];
+
+		/* a truncated datagram cannot hold a complete description */
+		if (!(msg->msg_hdr.msg_flags & MSG_TRUNC))
+			break;
+
+		us->cur++;
+	}
+
+	us->dgram.buf = (const char*)msg->msg_hdr.msg_iov->iov_base;
+	us->dgram.len = msg->msg_len;
+	us->dgram.offset = 0;
+	return 0;
+}
+
+static ssize_t sdp_stream_getline_view_usck(const char **line,
+		void *stream_ctx)
+{
+	struct usck_stream *us = (struct usck_stream*)stream_ctx;
+
+	if (!us->dgram.buf && sdp_stream_load_usck(us))
+		return -1;
+
+	return sdp_stream_getline_view_span(line, &us->dgram);
+}
+
+static ssize_t sdp_stream_peek_usck(const char **buf, void *stream_ctx)
+{
+	struct usck_stream *us = (struct usck_stream*)stream_ctx;
+
+	if (!us->dgram.buf && sdp_stream_load_usck(us))
+		return -1;
+
+	return sdp_stream_peek_span(buf, &us->dgram);
+}
+
+static int sdp_stream_skip_usck(void *stream_ctx, size_t n)
+{
+	struct usck_stream *us = (struct usck_stream*)stream_ctx;
+
+	if (!us->dgram.buf && sdp_stream_load_usck(us))
+		return -1;
+
+	return sdp_stream_skip_span(&us->dgram, n);
+}
+
+static int sdp_stream_next_usck(void *stream_ctx)
+{
+	struct usck_stream *us = (struct usck_stream*)stream_ctx;
+
+	/* a datagram is released once it has been loaded, even if it has
+	 * not been read through */
+	if (us->dgram.buf)
+		us->cur++;
+
+	memset(&us->dgram, 0, sizeof(struct span_stream));
+	return 0;
+}
+
+static const struct sdp_stream_ops sdp_stream_ops_usck = {
+	sdp_stream_open_usck,
+	sdp_stream_close_usck,
+	sdp_stream_getline_view_usck,
+	sdp_stream_next_usck,
+	sdp_stream_peek_usck,
+	sdp_stream_skip_usck,
+	NULL,
+};
+#endif
+
+/* Stream backends, the built-in types followed by the registered ones */
+static const struct sdp_stream_ops *sdp_stream_backends[
+		SDP_STREAM_TYPE_CUSTOM + SDP_STREAM_CUSTOM_MAX] = {
+	[SDP_STREAM_TYPE_FILE] = &sdp_stream_ops_file,
+	[SDP_STREAM_TYPE_CHAR] = &sdp_stream_ops_char,
+#if defined(__linux__)
+	[SDP_STREAM_TYPE_USCK] = &sdp_stream_ops_usck,
+	[SDP_STREAM_TYPE_MMAP] = &sdp_stream_ops_mmap,
+#endif
+	[SDP_STREAM_TYPE_BUF] = &sdp_stream_ops_buf,
+#if defined(__linux__)
+	[SDP_STREAM_TYPE_BUNDLE] = &sdp_stream_ops_bundle,
+#endif
+};
+
+int sdp_stream_register(const struct sdp_stream_ops *ops)
+{
+	int type;
+
+	if (!ops || !ops->open || !ops->close || !ops->getline_view)
+		return -1;
+
+	for (type = SDP_STREAM_TYPE_CUSTOM; type < (int)ARRAY_SIZE(
+			sdp_stream_backends); type++) {
+		if (!sdp_stream_backends[type]) {
+			sdp_stream_backends[type] = ops;
+			return type;
+		}
+	}
+
+	return -1;
+}
 
 /* Generic stream */
 sdp_stream_t sdp_stream_open(enum sdp_stream_type type, void *ctx)
 {
 	struct sdp_stream *sdp;
-	int ret;
+
+	if ((unsigned int)type >= ARRAY_SIZE(sdp_stream_backends) ||
+			!sdp_stream_backends[type]) {
+		return NULL;
+	}
 
 	sdp = (struct sdp_stream*)calloc(1, sizeof(struct sdp_stream));
 	if (!sdp)
 		return NULL;
 
-	switch (type) {
-	case SDP_STREAM_TYPE_FILE:
-		ret = sdp_stream_open_file(sdp, (char*)ctx);
-		break;
-	case SDP_STREAM_TYPE_CHAR:
-		ret = sdp_stream_open_char(sdp, (char*)ctx);
-		break;
-	case SDP_STREAM_TYPE_USCK:
-	default:
-		ret = -1;
-		break;
-	}
-
-	if (ret) {
+	sdp->ops = sdp_stream_backends[type];
+	if (sdp->ops->open(&sdp->ctx, ctx)) {
 		free(sdp);
 		return NULL;
 	}
@@ -137,44 +827,72 @@ int sdp_stream_close(sdp_stream_t stream)
 	struct sdp_stream *sdp = (struct sdp_stream*)stream;
 	int ret;
 
-	switch (sdp->type) {
-	case SDP_STREAM_TYPE_FILE:
-		ret = sdp_stream_close_file((FILE*)sdp->ctx);
-		break;
-	case SDP_STREAM_TYPE_CHAR:
-		ret = sdp_stream_close_char((struct buf_stream*)sdp->ctx);
-		break;
-	case SDP_STREAM_TYPE_USCK:
-	default:
-		ret = -1;
-		break;
-	}
-
-	if (!ret)
+	if (!(ret = sdp->ops->close(sdp->ctx)))
 		free(sdp);
 
 	return ret;
 }
 
+int sdp_stream_reopen(sdp_stream_t stream, void *ctx)
+{
+	struct sdp_stream *sdp = (struct sdp_stream*)stream;
+	void *stream_ctx;
+
+	if (sdp->ops->reopen)
+		return sdp->ops->reopen(sdp->ctx, ctx);
+
+	/* the current input is kept should the new one fail to open */
+	if (sdp->ops->open(&stream_ctx, ctx))
+		return -1;
+
+	sdp->ops->close(sdp->ctx);
+	sdp->ctx = stream_ctx;
+	return 0;
+}
+
 ssize_t sdp_stream_getline(char **lineptr, size_t *n, sdp_stream_t stream)
+{
+	const char *line = NULL;
+	ssize_t len;
+
+	len = sdp_stream_getline_view(&line, stream);
+	return sdp_stream_line_copy(lineptr, n, line, len);
+}
+
+ssize_t sdp_stream_getline_view(const char **line, sdp_stream_t stream)
 {
 	struct sdp_stream *sdp = (struct sdp_stream*)stream;
-	ssize_t ret;
 
-	switch (sdp->type) {
-	case SDP_STREAM_TYPE_FILE:
-		ret = sdp_stream_getline_file(lineptr, n, (FILE*)sdp->ctx);
-		break;
-	case SDP_STREAM_TYPE_CHAR:
-		ret = sdp_stream_getline_char(lineptr, n,
-			(struct buf_stream*)sdp->ctx);
-		break;
-	case SDP_STREAM_TYPE_USCK:
-	default:
-		ret = -1;
-		break;
-	}
+	return sdp->ops->getline_view(line, sdp->ctx);
+}
 
-	return ret;
+int sdp_stream_next(sdp_stream_t stream)
+{
+	struct sdp_stream *sdp = (struct sdp_stream*)stream;
+
+	/* single document streams */
+	if (!sdp->ops->next)
+		return -1;
+
+	return sdp->ops->next(sdp->ctx);
 }
 
+ssize_t sdp_stream_peek(const char **buf, sdp_stream_t stream)
+{
+	struct sdp_stream *sdp = (struct sdp_stream*)stream;
+
+	if (!sdp->ops->peek)
+		return -1;
+
+	return sdp->ops->peek(buf, sdp->ctx);
+}
+
+int sdp_stream_skip(sdp_stream_t stream, size_t n)
+{
+	struct sdp_stream *sdp = (struct sdp_stream*)stream;
+
+	if (!sdp->ops->skip)
+		return -1;
+
+	return sdp->ops->skip(sdp->ctx, n);
+}
@@ -1,6 +1,8 @@
 #ifndef _SDP_STREAM_
 #define _SDP_STREAM_
 
+#include <stddef.h>
+
 #ifdef _WIN32
 #include "sdp_compat.h"
 #endif
@@ -16,16 +18,89 @@ enum sdp_stream_type {
 	SDP_STREAM_TYPE_FILE, /* Regular file */
 	SDP_STREAM_TYPE_CHAR, /* Memory buffer */
 	SDP_STREAM_TYPE_USCK, /* UDP socket */
+	SDP_STREAM_TYPE_MMAP, /* Memory mapped regular file */
+	SDP_STREAM_TYPE_BUF, /* Length bounded memory buffer */
+	SDP_STREAM_TYPE_BUNDLE, /* Memory mapped file of many documents */
+	SDP_STREAM_TYPE_CUSTOM, /* First of the registered backends */
+};
+
+/* Maximum number of registered backends */
+#define SDP_STREAM_CUSTOM_MAX 16
+
+/* USCK stream input */
+struct sdp_stream_usck {
+	int fd; /* bound datagram socket, remains owned by the caller */
+	unsigned int batch; /* datagrams per receive call, 0 for default */
+	size_t buf_size; /* largest datagram accepted, 0 for default */
+};
+
+/* BUF stream input */
+struct sdp_stream_buf {
+	const char *buf; /* need not be null-terminated */
+	size_t len;
 };
 
 typedef void *sdp_stream_t;
 
+/* Stream backend
+ * Every stream type is implemented by a table of functions operating on a
+ * context of its own. Applications register their own backends to feed the
+ * parser out of their storage (shared memory rings, packet buffers...)
+ * without first gathering it into a string. The parser still copies what
+ * it reads, a block at a time. */
+struct sdp_stream_ops {
+	/* sets *stream_ctx from the ctx passed to sdp_stream_open(), returns 0
+	 * on success, -1 otherwise */
+	int (*open)(void **stream_ctx, void *ctx);
+	/* releases stream_ctx, as sdp_stream_close() */
+	int (*close)(void *stream_ctx);
+	/* as sdp_stream_getline_view() */
+	ssize_t (*getline_view)(const char **line, void *stream_ctx);
+
+	/* optional, NULL if not supported by the backend. As
+	 * sdp_stream_next(), sdp_stream_peek() and sdp_stream_skip() */
+	int (*next)(void *stream_ctx);
+	ssize_t (*peek)(const char **buf, void *stream_ctx);
+	int (*skip)(void *stream_ctx, size_t n);
+	/* optional, as sdp_stream_reopen(). The stream is left untouched on
+	 * failure */
+	int (*reopen)(void *stream_ctx, void *ctx);
+};
+
+/** Register a stream backend
+ * Registration is meant to take place once at start-up, before streams are
+ * opened, and is not thread safe. The table must outlive any stream opened
+ * with it.
+ *
+ * @param ops        backend functions, open, close and getline_view are
+ *                   mandatory.
+ *
+ * @return the stream type (SDP_STREAM_TYPE_CUSTOM onward) to pass to
+ *         sdp_stream_open() or sdp_parser_init(), -1 otherwise.
+ */
+int sdp_stream_register(const struct sdp_stream_ops *ops);
+
 /** Open an SDP stream
  * @param type       type of stream to open.
  * @param ctx        input for open function:
  *  - FILE           ctx is a string indicating the path to the file
  *  - CHAR           ctx is a pointer to the memory buffer location
- *  - USCK           TBD
+ *  - USCK           ctx is a pointer to a struct sdp_stream_usck. Each
+ *                   datagram is a document, see sdp_stream_next(). Datagrams
+ *                   are received in batches into buffers preallocated on
+ *                   open and read in place
+ *  - MMAP           ctx is a string indicating the path to the file
+ *  - BUF            ctx is a pointer to a struct sdp_stream_buf. The stream
+ *                   never reads past buf + len. The descriptor is copied on
+ *                   open, the buffer itself must outlive the stream. The
+ *                   buffer is only read, the parser copying what it parses
+ *  - BUNDLE         ctx is a string indicating the path to the file. The
+ *                   file holds many documents, either concatenated or as
+ *                   the regular file members of a tar archive, each member
+ *                   holding one or more documents. A document starts at a
+ *                   line beginning with v=, see sdp_stream_next()
+ *  - CUSTOM onward  ctx is passed on to the open function of the registered
+ *                   backend
  * 
  * @return an sdp stream context on success, NULL otherwise.
  */
@@ -38,6 +113,18 @@ sdp_stream_t sdp_stream_open(enum sdp_stream_type type, void *ctx);
  */
 int sdp_stream_close(sdp_stream_t stream);
 
+/** Point an SDP stream at another input
+ * The input is as passed to sdp_stream_open() for the type of the stream.
+ * CHAR, BUF and MMAP streams are reused as they are, with no allocation.
+ * Other streams open the new input before closing the current one.
+ *
+ * @param stream     The context of the SDP steram to use.
+ * @param ctx        The new input.
+ *
+ * @return 0 on success, -1 otherwise, the current input remaining open.
+ */
+int sdp_stream_reopen(sdp_stream_t stream, void *ctx);
+
 /** Get a single SDP line
  * Reads an entire line from stream, storing the address of the buffer
  * containing the text into *lineptr. The buffer is null-terminated and
@@ -56,6 +143,68 @@ int sdp_stream_close(sdp_stream_t stream);
  */
 ssize_t sdp_stream_getline(char **lineptr, size_t *n, sdp_stream_t stream);
 
+/** Get a single SDP line without copying it
+ * Sets *line to point at the next line within the stream's own storage
+ * instead of copying it out. The line is not null-terminated and includes
+ * the newline character, if one was found. It remains valid until the next
+ * line is read or the stream is closed.
+ *
+ * For CHAR, BUF and MMAP streams the line points into the caller's buffer or
+ * the mapped file respectively. FILE streams keep a line buffer of their own.
+ *
+ * The copy avoided is the stream's only. The parser still copies what it
+ * reads into a buffer of its own, as it tokenizes lines in place.
+ *
+ * @param line       A pointer to the location of the line in the stream.
+ * @param stream     The context of the SDP steram to use.
+ *
+ * @return the number of characters in the line (including the endofline),
+ *         0 at the end of the stream, -1 otherwise.
+ */
+ssize_t sdp_stream_getline_view(const char **line, sdp_stream_t stream);
+
+/** Move to the next document of a multi-document stream
+ * A USCK stream ends its lines at the end of each datagram. This releases the
+ * current datagram so that reading continues with the next one, receiving a
+ * new batch once the pending datagrams have been consumed.
+ *
+ * A BUNDLE stream ends its lines at the end of each document, the first
+ * document is current once the stream is opened. A session per document is
+ * parsed along the lines of:
+ *
+ *   do {
+ *           session = sdp_parser_init_stream(stream);
+ *           sdp_session_parse(session, parse_attr_specific, ctx);
+ *           ...
+ *   } while (!sdp_stream_next(stream));
+ *
+ * @param stream     The context of the SDP steram to use.
+ *
+ * @return 0 on success, -1 for single document streams or once a BUNDLE
+ *         stream has no more documents.
+ */
+int sdp_stream_next(sdp_stream_t stream);
+
+/** Look at the unread part of the current document
+ * Lets a framing protocol carrying SDP (e.g. SAP) inspect its header in place
+ * before handing the rest of the document to the parser. Not provided by
+ * FILE streams.
+ *
+ * @param buf        A pointer to the location of the unread data.
+ * @param stream     The context of the SDP steram to use.
+ *
+ * @return the number of unread bytes, -1 otherwise.
+ */
+ssize_t sdp_stream_peek(const char **buf, sdp_stream_t stream);
+
+/** Skip bytes of the current document
+ * @param stream     The context of the SDP steram to use.
+ * @param n          Number of bytes to skip, at most as many as are unread.
+ *
+ * @return 0 on success, -1 otherwise.
+ */
+int sdp_stream_skip(sdp_stream_t stream, size_t n);
+
 #ifdef __linux__
 #ifdef __cplusplus
 }
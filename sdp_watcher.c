@@ -0,0 +1,403 @@
+#define _GNU_SOURCE /* O_CLOEXEC */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "smpte2110_sdp_parser.h"
+#include "sdp_watcher.h"
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | \
+	IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF)
+#define WATCH_BUCKETS_MIN 64
+#define WATCH_READ_SIZE 4096
+
+#define FNV1A_OFFSET 14695981039346656037ULL
+#define FNV1A_PRIME 1099511628211ULL
+
+struct watch_entry {
+	struct sdp_watcher_entry e;
+	unsigned int generation; /* of the last directory scan to see it */
+	struct watch_entry *next;
+};
+
+struct sdp_watcher {
+	int fd;
+	char *dir;
+	sdp_watcher_cb_t cb;
+	void *ctx;
+	struct watch_entry **buckets;
+	size_t nbuckets; /* power of 2 */
+	size_t nentries;
+	unsigned int generation;
+};
+
+static size_t watch_hash(const char *name)
+{
+	uint64_t h = FNV1A_OFFSET;
+
+	while (*name)
+		h = (h ^ (uint8_t)*name++) * FNV1A_PRIME;
+
+	return (size_t)h;
+}
+
+static struct watch_entry **watch_locate(struct sdp_watcher *w,
+		const char *name)
+{
+	struct watch_entry **we;
+
+	we = &w->buckets[watch_hash(name) & (w->nbuckets - 1)];
+	for ( ; *we && strcmp((*we)->e.name, name); we = &(*we)->next);
+
+	return we;
+}
+
+static int watch_grow(struct sdp_watcher *w)
+{
+	struct watch_entry **buckets;
+	size_t nbuckets = w->nbuckets << 1;
+	size_t i;
+
+	buckets = (struct watch_entry**)calloc(nbuckets,
+		sizeof(struct watch_entry*));
+	if (!buckets)
+		return -1;
+
+	for (i = 0; i < w->nbuckets; i++) {
+		struct watch_entry *we;
+
+		while ((we = w->buckets[i])) {
+			size_t b = watch_hash(we->e.name) & (nbuckets - 1);
+
+			w->buckets[i] = we->next;
+			we->next = buckets[b];
+			buckets[b] = we;
+		}
+	}
+
+	free(w->buckets);
+	w->buckets = buckets;
+	w->nbuckets = nbuckets;
+	return 0;
+}
+
+static void watch_entry_clear(struct watch_entry *we)
+{
+	/* the extractor borrows the session */
+	if (we->e.extractor)
+		sdp_extractor_uninit(we->e.extractor);
+	if (we->e.session)
+		sdp_parser_uninit(we->e.session);
+
+	we->e.extractor = NULL;
+	we->e.session = NULL;
+}
+
+static void watch_entry_free(struct watch_entry *we)
+{
+	watch_entry_clear(we);
+	free(we->e.name);
+	free(we);
+}
+
+/* the file is fed to the parser as it is read, returns -1 if it is not a
+ * regular file that can be read */
+static int watch_file_parse(struct sdp_watcher *w, const char *name,
+		struct sdp_watcher_entry *e)
+{
+	char path[PATH_MAX];
+	char buf[WATCH_READ_SIZE];
+	struct stat st;
+	ssize_t len;
+	int fd;
+
+	e->session = NULL;
+	e->extractor = NULL;
+	e->err = SDP_PARSE_ERROR;
+
+	snprintf(path, sizeof(path), "%s/%s", w->dir, name);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return -1;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return -1;
+	}
+
+	if (!(e->session = sdp_parser_init_push(
+			smpte2110_sdp_parse_specific, NULL))) {
+		close(fd);
+		return 0;
+	}
+	/* entry sessions are handed out, with their addresses as text */
+	e->session->is_addr_text = 1;
+
+	while ((len = read(fd, buf, sizeof(buf))) > 0 ||
+			(len == -1 && errno == EINTR)) {
+		if (len > 0 && sdp_parser_feed(e->session, buf, len) !=
+				SDP_PARSE_OK) {
+			break;
+		}
+	}
+	close(fd);
+
+	e->err = sdp_parser_finish(e->session);
+	if (e->err != SDP_PARSE_OK) {
+		sdp_parser_uninit(e->session);
+		e->session = NULL;
+		return 0;
+	}
+
+	/* entries are kept for as long as their file is */
+	sdp_session_compact(e->session);
+	e->extractor = sdp_extractor_init_session(e->session);
+	return 0;
+}
+
+static int watch_remove(struct sdp_watcher *w, const char *name)
+{
+	struct watch_entry **we = watch_locate(w, name);
+	struct watch_entry *removed = *we;
+
+	if (!removed)
+		return 0;
+
+	*we = removed->next;
+	w->nentries--;
+
+	w->cb((sdp_watcher_t)w, SDP_WATCHER_EVENT_REMOVED, &removed->e,
+		w->ctx);
+	watch_entry_free(removed);
+	return 1;
+}
+
+/* reparse a single file, returns the number of changes reported */
+static int watch_update(struct sdp_watcher *w, const char *name)
+{
+	struct sdp_watcher_entry e;
+	struct watch_entry **we;
+	enum sdp_watcher_event event;
+
+	if (watch_file_parse(w, name, &e))
+		return watch_remove(w, name);
+
+	we = watch_locate(w, name);
+	if (*we) {
+		watch_entry_clear(*we);
+		(*we)->e.err = e.err;
+		(*we)->e.session = e.session;
+		(*we)->e.extractor = e.extractor;
+		event = SDP_WATCHER_EVENT_CHANGED;
+	} else {
+		if (w->nbuckets < w->nentries + 1 && !watch_grow(w))
+			we = watch_locate(w, name);
+
+		if (!(*we = (struct watch_entry*)calloc(1,
+				sizeof(struct watch_entry))) ||
+				!((*we)->e.name = strdup(name))) {
+			free(*we);
+			*we = NULL;
+			if (e.extractor)
+				sdp_extractor_uninit(e.extractor);
+			if (e.session)
+				sdp_parser_uninit(e.session);
+			sdperr("memory allocation");
+			return 0;
+		}
+
+		(*we)->e.err = e.err;
+		(*we)->e.session = e.session;
+		(*we)->e.extractor = e.extractor;
+		w->nentries++;
+		event = SDP_WATCHER_EVENT_ADDED;
+	}
+
+	(*we)->generation = w->generation;
+	w->cb((sdp_watcher_t)w, event, &(*we)->e, w->ctx);
+	return 1;
+}
+
+/* reparse the whole directory, dropping entries no longer found in it. Only
+ * needed on start up and when inotify has lost track of changes */
+static int watch_scan(struct sdp_watcher *w)
+{
+	struct dirent *de;
+	DIR *d;
+	size_t i;
+	int changes = 0;
+
+	if (!(d = opendir(w->dir)))
+		return -1;
+
+	w->generation++;
+	while ((de = readdir(d))) {
+		if (*de->d_name == '.')
+			continue;
+
+		changes += watch_update(w, de->d_name);
+	}
+	closedir(d);
+
+	for (i = 0; i < w->nbuckets; i++) {
+		struct watch_entry *we = w->buckets[i];
+
+		while (we) {
+			struct watch_entry *tmp = we;
+
+			we = we->next;
+			if (tmp->generation != w->generation)
+				changes += watch_remove(w, tmp->e.name);
+		}
+	}
+
+	return changes;
+}
+
+int sdp_watcher_process(sdp_watcher_t watcher)
+{
+	struct sdp_watcher *w = (struct sdp_watcher*)watcher;
+	char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	int changes = 0;
+
+	for (;;) {
+		ssize_t len;
+		char *ptr;
+
+		len = read(w->fd, buf, sizeof(buf));
+		if (len == -1 && errno == EINTR)
+			continue;
+		if (len == -1 && errno == EAGAIN)
+			break;
+		if (len <= 0)
+			return -1;
+
+		for (ptr = buf; ptr < buf + len;
+				ptr += sizeof(struct inotify_event) +
+				((struct inotify_event*)ptr)->len) {
+			struct inotify_event *ev = (struct inotify_event*)ptr;
+
+			/* the directory itself is gone */
+			if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF |
+					IN_IGNORED)) {
+				sdperr("watched directory removed: %s", w->dir);
+				return -1;
+			}
+
+			if (ev->mask & IN_Q_OVERFLOW) {
+				int ret;
+
+				if ((ret = watch_scan(w)) == -1)
+					return -1;
+				changes += ret;
+				continue;
+			}
+
+			if (!ev->len || *ev->name == '.')
+				continue;
+
+			if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				changes += watch_update(w, ev->name);
+			else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+				changes += watch_remove(w, ev->name);
+		}
+	}
+
+	return changes;
+}
+
+int sdp_watcher_fd(sdp_watcher_t watcher)
+{
+	return ((struct sdp_watcher*)watcher)->fd;
+}
+
+struct sdp_watcher_entry *sdp_watcher_get(sdp_watcher_t watcher,
+		const char *name)
+{
+	struct watch_entry *we;
+
+	we = *watch_locate((struct sdp_watcher*)watcher, name);
+	return we ? &we->e : NULL;
+}
+
+void sdp_watcher_foreach(sdp_watcher_t watcher,
+		void (*func)(struct sdp_watcher_entry *entry, void *ctx),
+		void *ctx)
+{
+	struct sdp_watcher *w = (struct sdp_watcher*)watcher;
+	size_t i;
+
+	for (i = 0; i < w->nbuckets; i++) {
+		struct watch_entry *we;
+
+		for (we = w->buckets[i]; we; we = we->next)
+			func(&we->e, ctx);
+	}
+}
+
+sdp_watcher_t sdp_watcher_init(char *dir, sdp_watcher_cb_t cb, void *ctx)
+{
+	struct sdp_watcher *w;
+
+	w = (struct sdp_watcher*)calloc(1, sizeof(struct sdp_watcher));
+	if (!w)
+		return NULL;
+
+	w->cb = cb;
+	w->ctx = ctx;
+	w->fd = -1;
+	w->nbuckets = WATCH_BUCKETS_MIN;
+	w->buckets = (struct watch_entry**)calloc(w->nbuckets,
+		sizeof(struct watch_entry*));
+	if (!w->buckets || !(w->dir = strdup(dir)))
+		goto fail;
+
+	if ((w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1)
+		goto fail;
+
+	/* watch first, so that no change slips in between the scan and the
+	 * watch */
+	if (inotify_add_watch(w->fd, dir, WATCH_EVENTS | IN_ONLYDIR) == -1) {
+		sdperr("cannot watch directory: %s", dir);
+		goto fail;
+	}
+
+	if (watch_scan(w) == -1)
+		goto fail;
+
+	return (sdp_watcher_t)w;
+
+fail:
+	sdp_watcher_uninit((sdp_watcher_t)w);
+	return NULL;
+}
+
+void sdp_watcher_uninit(sdp_watcher_t watcher)
+{
+	struct sdp_watcher *w = (struct sdp_watcher*)watcher;
+	size_t i;
+
+	for (i = 0; w->buckets && i < w->nbuckets; i++) {
+		struct watch_entry *we;
+
+		while ((we = w->buckets[i])) {
+			w->buckets[i] = we->next;
+			watch_entry_free(we);
+		}
+	}
+
+	if (w->fd != -1)
+		close(w->fd);
+	free(w->buckets);
+	free(w->dir);
+	free(w);
+}
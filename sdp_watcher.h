@@ -0,0 +1,75 @@
+#ifndef _SDP_WATCHER_H_
+#define _SDP_WATCHER_H_
+
+#include "sdp_parser.h"
+#include "sdp_extractor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SDP directory watcher
+ *
+ * Follows a directory of SDP files through inotify and keeps a live table
+ * of their parsed sessions and extraction results. Only files that are
+ * written, moved in, moved out or deleted are reparsed or dropped, each
+ * change being reported through a callback. Hidden files (.*) are
+ * ignored. */
+
+enum sdp_watcher_event {
+	SDP_WATCHER_EVENT_ADDED, /* file appeared in the directory */
+	SDP_WATCHER_EVENT_CHANGED, /* file was rewritten and reparsed */
+	SDP_WATCHER_EVENT_REMOVED, /* file left the directory */
+};
+
+struct sdp_watcher_entry {
+	char *name; /* file name within the directory */
+	enum sdp_parse_err err; /* result of parsing the file */
+	/* NULL if parsing failed, compacted, see sdp_session_compact() */
+	struct sdp_session *session;
+	/* NULL if the session is not a supported SMPTE ST2110-20 one */
+	sdp_extractor_t extractor;
+};
+
+typedef void *sdp_watcher_t;
+
+/* entries belong to the watcher. A removed entry is released once the
+ * callback returns */
+typedef void (*sdp_watcher_cb_t)(sdp_watcher_t watcher,
+	enum sdp_watcher_event event, struct sdp_watcher_entry *entry,
+	void *ctx);
+
+/** Watch a directory
+ * The files already in the directory are parsed and reported as added
+ * before returning.
+ *
+ * @return a watcher on success, NULL otherwise.
+ */
+sdp_watcher_t sdp_watcher_init(char *dir, sdp_watcher_cb_t cb, void *ctx);
+void sdp_watcher_uninit(sdp_watcher_t watcher);
+
+/** Get the watcher's file descriptor
+ * Becomes readable whenever there are changes to process, to be used with
+ * poll(2) and the like.
+ */
+int sdp_watcher_fd(sdp_watcher_t watcher);
+
+/** Process pending changes
+ * Reparses changed files, reporting each change. Does not block.
+ *
+ * @return the number of changes reported, -1 on error.
+ */
+int sdp_watcher_process(sdp_watcher_t watcher);
+
+/* Live table */
+struct sdp_watcher_entry *sdp_watcher_get(sdp_watcher_t watcher,
+		const char *name);
+void sdp_watcher_foreach(sdp_watcher_t watcher,
+		void (*func)(struct sdp_watcher_entry *entry, void *ctx),
+		void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,6 +6,10 @@
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
 #endif
 
+#ifndef NOT_IN_USE
+#define NOT_IN_USE(a) ((void)(a))
+#endif
+
 #define SMPTE_2110_ATTR_PARAM_ERR_REQUIRED (SMPTE_ERR_SAMPLING | \
 		SMPTE_ERR_DEPTH | SMPTE_ERR_WIDTH | SMPTE_ERR_HEIGHT | \
 		SMPTE_ERR_EXACTFRAMERATE | SMPTE_ERR_COLORIMETRY | \
@@ -560,11 +564,12 @@ static enum sdp_parse_err sdp_attr_param_parse_cmax(char *str,
 }
 
 static enum sdp_parse_err smpte2110_sdp_parse_fmtp_params(
-		struct sdp_media *media,struct sdp_attr *a, char *value,
-		char *params)
+		struct sdp_session *session, struct sdp_media *media,
+		struct sdp_attr *a, char *value, char *params)
 {
 	struct attr_params p;
 	char *token;
+	char *tmp;
 	char *endptr;
 	struct smpte2110_media_attr_fmtp *smpte2110_fmtp;
 	size_t i;
@@ -600,8 +605,12 @@ static enum sdp_parse_err smpte2110_sdp_parse_fmtp_params(
 	for (rtpmap_attr = sdp_media_attr_get(media, SDP_ATTR_RTPMAP);
 			rtpmap_attr;
 			rtpmap_attr = sdp_attr_get_next(rtpmap_attr )) {
-		if (strncmp(rtpmap_attr->value.rtpmap.media_subtype, "raw", 3))
+		/* an untyped first attribute is returned whatever the type */
+		if (rtpmap_attr->type != SDP_ATTR_RTPMAP ||
+				strncmp(rtpmap_attr->value.rtpmap.media_subtype,
+				"raw", 3)) {
 			continue;
+		}
 
 		if (rtpmap_attr->value.rtpmap.fmt == fmt)
 			break;
@@ -614,8 +623,8 @@ static enum sdp_parse_err smpte2110_sdp_parse_fmtp_params(
 	if (!rtpmap_attr)
 		return SDP_PARSE_NOT_SUPPORTED;
 
-	smpte2110_fmtp = (struct smpte2110_media_attr_fmtp *)calloc(1,
-		sizeof(struct smpte2110_media_attr_fmtp));
+	smpte2110_fmtp = (struct smpte2110_media_attr_fmtp *)sdp_session_alloc(
+		session, sizeof(struct smpte2110_media_attr_fmtp));
 	if (!smpte2110_fmtp) {
 		sdperr("Memory allocation");
 		goto fail;
@@ -624,7 +633,7 @@ static enum sdp_parse_err smpte2110_sdp_parse_fmtp_params(
 	attribute_params_set_defaults(&p);
 
 	smpte2110_fmtp->err = 0; /* no attribute params have been parsed */
-	while ((token = strtok(params, ";"))) {
+	while ((token = strtok_r(params, ";", &tmp))) {
 		/* skip the white space(s) peceding the current token */
 		while (IS_WHITESPACE(*token))
 			token++;
@@ -696,17 +705,18 @@ static enum sdp_parse_err smpte2110_sdp_parse_fmtp_params(
 
 	a->type = SDP_ATTR_FMTP;
 	a->value.fmtp.params = smpte2110_fmtp;
-	a->value.fmtp.param_dtor = free;
+	a->value.fmtp.param_dtor = NULL;
 
 	return SDP_PARSE_OK;
 
 fail:
-	free(smpte2110_fmtp);
+	/* whatever was allocated is released with the session */
 	return SDP_PARSE_ERROR;
 }
 
-static enum sdp_parse_err smpte2110_sdp_parse_group(struct sdp_attr *a,
-		char *value, char *params)
+static enum sdp_parse_err smpte2110_sdp_parse_group(
+		struct sdp_session *session, struct sdp_attr *a, char *value,
+		char *params)
 {
 	char *tmp;
 	struct group_identification_tag **tag;
@@ -722,20 +732,21 @@ static enum sdp_parse_err smpte2110_sdp_parse_group(struct sdp_attr *a,
 		return SDP_PARSE_ERROR;
 	}
 
-	if (!(group->semantic = strdup(value))) {
+	if (!(group->semantic = sdp_session_strdup(session, value))) {
 		sdperr("memory allocation");
-		goto fail;
+		return SDP_PARSE_ERROR;
 	}
 
 	tag = &group->tag;
 	do {
 		char *cur = strtok_r(params, " ", &tmp);
 
-		*tag = (struct group_identification_tag*)calloc(1,
-			sizeof(struct group_identification_tag));
-		if (!*tag || !((*tag)->identification_tag = strdup(cur))) {
+		*tag = (struct group_identification_tag*)sdp_session_alloc(
+			session, sizeof(struct group_identification_tag));
+		if (!*tag || !((*tag)->identification_tag =
+				sdp_session_strdup(session, cur))) {
 			sdperr("memory allocation");
-			goto fail;
+			return SDP_PARSE_ERROR;
 		}
 
 		group->num_tags++;
@@ -745,32 +756,58 @@ static enum sdp_parse_err smpte2110_sdp_parse_group(struct sdp_attr *a,
 
 	a->type = SDP_ATTR_GROUP;
 	return SDP_PARSE_OK;
-
-fail:
-	tag = &group->tag;
-	while (*tag) {
-		struct group_identification_tag *tmp = *tag;
-
-		tag = &(*tag)->next;
-		free(tmp->identification_tag);
-		free(tmp);
-	}
-
-	return SDP_PARSE_ERROR;
 }
 
-enum sdp_parse_err smpte2110_sdp_parse_specific(struct sdp_media *media,
-		struct sdp_attr *a, char *attr, char *value, char *params)
+enum sdp_parse_err smpte2110_sdp_parse_specific(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a, char *attr,
+		char *value, char *params, void *ctx)
 {
+	NOT_IN_USE(ctx);
+
 	if (media && media->m.type != SDP_MEDIA_TYPE_VIDEO)
 		return SDP_PARSE_OK;
 
 	if (!strncmp(attr, "fmtp", strlen("fmtp")))
-		return smpte2110_sdp_parse_fmtp_params(media, a, value, params);
+		return smpte2110_sdp_parse_fmtp_params(session, media, a, value,
+			params);
 
 	if (!strncmp(attr, "group", strlen("group")))
-		return smpte2110_sdp_parse_group(a, value, params);
+		return smpte2110_sdp_parse_group(session, a, value, params);
 
 	return SDP_PARSE_ERROR;
 }
 
+static enum sdp_parse_err smpte2110_sdp_parse_fmtp(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a, char *attr,
+		char *value, char *params, void *ctx)
+{
+	NOT_IN_USE(attr);
+	NOT_IN_USE(ctx);
+
+	return smpte2110_sdp_parse_fmtp_params(session, media, a, value,
+		params);
+}
+
+static enum sdp_parse_err smpte2110_sdp_parse_group_dup(
+		struct sdp_session *session, struct sdp_media *media,
+		struct sdp_attr *a, char *attr, char *value, char *params,
+		void *ctx)
+{
+	NOT_IN_USE(media);
+	NOT_IN_USE(attr);
+	NOT_IN_USE(ctx);
+
+	return smpte2110_sdp_parse_group(session, a, value, params);
+}
+
+int smpte2110_sdp_profile_register(struct sdp_profile *profile)
+{
+	if (sdp_profile_register(profile, "group", SDP_MEDIA_TYPE_NONE,
+			smpte2110_sdp_parse_group_dup, NULL) ||
+			sdp_profile_register(profile, "fmtp",
+			SDP_MEDIA_TYPE_VIDEO, smpte2110_sdp_parse_fmtp, NULL)) {
+		return -1;
+	}
+
+	return 0;
+}
@@ -141,8 +141,15 @@ struct smpte2110_media_attr_fmtp {
 	uint32_t err;
 };
 
-enum sdp_parse_err smpte2110_sdp_parse_specific(struct sdp_media *media,
-		struct sdp_attr *a, char *attr, char *value, char *params);
+/* ctx is not used */
+enum sdp_parse_err smpte2110_sdp_parse_specific(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a, char *attr,
+		char *value, char *params, void *ctx);
+
+/* registers the ST2110-20 parsers of group (DUP) and video fmtp, the
+ * profile equivalent of smpte2110_sdp_parse_specific(). Returns 0 on
+ * success, -1 otherwise */
+int smpte2110_sdp_profile_register(struct sdp_profile *profile);
 
 #ifdef __cplusplus
 }
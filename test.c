@@ -1,7 +1,177 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include "smpte2110_sdp_parser.h"
+#include "sdp_extractor.h"
+#include "sdp_watcher.h"
+#include "sdp_sap.h"
+#include "sdp_loader.h"
 
-int main (int argc, char **argv)
+/* Tests, run from the top of the tree for the examples to be found
+ *
+ *   make check */
+
+#define EXAMPLE "examples/ias.sdp"
+
+#define CHECK(_cond_) do { \
+		if (!(_cond_)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, \
+				__LINE__, #_cond_); \
+			ret = -1; \
+			goto exit; \
+		} \
+	} while (0)
+
+/* allocations made while counting, the test being linked with
+ * --wrap=malloc,--wrap=calloc,--wrap=realloc */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static int is_alloc_counted;
+static int alloc_count;
+
+void *__wrap_malloc(size_t size)
+{
+	if (is_alloc_counted)
+		__sync_fetch_and_add(&alloc_count, 1);
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	if (is_alloc_counted)
+		__sync_fetch_and_add(&alloc_count, 1);
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	if (is_alloc_counted)
+		__sync_fetch_and_add(&alloc_count, 1);
+	return __real_realloc(ptr, size);
+}
+
+static char *sdp =
+	"v=0\n"
+	"o=- 123456 11 IN IP4 192.168.100.2\n"
+	"s=Example of a SMPTE ST2110-20 signal\n"
+	"i=this example is for 720p video at 59.94\n"
+	"t=0 0\n"
+	"a=recvonly\n"
+	"a=group:DUP primary secondary\n"
+	"m=video 50000 RTP/AVP 112\n"
+	"c=IN IP4 239.100.9.10/32\n"
+	"a=source-filter:incl IN IP4 239.100.9.10 192.168.100.2\n"
+	"a=rtpmap:112 raw/90000\n"
+	"a=fmtp:112 sampling=YCbCr-4:2:2; width=1280; height=720; "
+		"exactframerate=60000/1001; depth=10; TCS=SDR; "
+		"colorimetry=BT709; PM=2110GPM; TP=2110TPN; "
+		"SSN=ST2110-20:2017; \n"
+	"a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:37\n"
+	"a=mediaclk:direct=0\n"
+	"a=mid:primary\n"
+	"m=video 50020 RTP/AVP 112\n"
+	"c=IN IP4 239.101.9.10/32\n"
+	"a=source-filter:incl IN IP4 239.101.9.10 192.168.101.2\n"
+	"a=rtpmap:112 raw/90000\n"
+	"a=fmtp:112 sampling=YCbCr-4:2:2; width=1280; height=720; "
+		"exactframerate=60000/1001; depth=10; TCS=SDR; "
+		"colorimetry=BT709; PM=2110GPM; TP=2110TPN; "
+		"SSN=ST2110-20:2017; \n"
+	"a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:37\n"
+	"a=mediaclk:direct=0\n"
+	"a=mid:secondary\n";
+
+/* the example, null-terminated */
+static char *example_read(size_t *len)
+{
+	FILE *f;
+	char *buf;
+	long size;
+
+	if (!(f = fopen(EXAMPLE, "r")))
+		return NULL;
+
+	if (fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0 ||
+			fseek(f, 0, SEEK_SET) ||
+			!(buf = (char*)malloc(size + 1))) {
+		fclose(f);
+		return NULL;
+	}
+
+	*len = fread(buf, 1, size, f);
+	buf[*len] = 0;
+	fclose(f);
+
+	return buf;
+}
+
+/* what the accessors report of a session, to compare parses with. Returns
+ * an allocated string, NULL on failure */
+static char *session_dump(struct sdp_session *session)
+{
+	struct sdp_media *media;
+	struct sdp_attr *a;
+	char *buf = NULL;
+	size_t size;
+	FILE *f;
+
+	if (!(f = open_memstream(&buf, &size)))
+		return NULL;
+
+	fprintf(f, "s=%s c=%08x", session->s, session->c.addr.u.ip4.s_addr);
+	if ((a = sdp_session_attr_get(session, SDP_ATTR_GROUP)))
+		fprintf(f, " group=%d", a->value.group.num_tags);
+
+	for (media = sdp_media_get(session, SDP_MEDIA_TYPE_NONE); media;
+			media = media->next) {
+		fprintf(f, "\nm=%d/%d c=%08x", media->m.type, media->m.port,
+			media->c.addr.u.ip4.s_addr);
+
+		if ((a = sdp_media_attr_get(media, SDP_ATTR_RTPMAP))) {
+			fprintf(f, " rtpmap=%d/%s/%d", a->value.rtpmap.fmt,
+				a->value.rtpmap.media_subtype,
+				a->value.rtpmap.clock_rate);
+		}
+
+		if ((a = sdp_media_attr_get(media, SDP_ATTR_FMTP)) &&
+				a->type == SDP_ATTR_FMTP) {
+			struct smpte2110_media_attr_fmtp *fmtp =
+				(struct smpte2110_media_attr_fmtp*)
+				a->value.fmtp.params;
+
+			fprintf(f, " fmtp=%dx%d", fmtp->params.width,
+				fmtp->params.height);
+		}
+
+		if ((a = sdp_media_attr_get(media, SDP_ATTR_SOURCE_FILTER))) {
+			struct sdp_attr_value_source_filter *filter =
+				&a->value.source_filter;
+
+			fprintf(f, " source-filter=%d/%d/%08x", filter->mode,
+				filter->spec.src_list_len,
+				filter->spec.src_list.src.u.ip4.s_addr);
+		}
+
+		if ((a = sdp_media_attr_get(media, SDP_ATTR_MID)))
+			fprintf(f, " mid=%s", a->value.mid.identification_tag);
+	}
+
+	if (fclose(f)) {
+		free(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static int test_parse(void)
 {
 	enum sdp_parse_err err;
 	struct sdp_session *session;
@@ -10,48 +180,1732 @@ int main (int argc, char **argv)
 		"SDP_PARSE_NOT_SUPPORTED",
 		"SDP_PARSE_ERROR"
 	};
-	char *sdp = 
+
+	session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, sdp);
+	if (!session) {
+		printf("failed to initialize sdp session\n");
+		return -1;
+	}
+
+	err = sdp_session_parse(session, smpte2110_sdp_parse_specific, NULL);
+	printf("parsing result: %s\n", err2str[err]);
+
+	sdp_parser_uninit(session);
+
+	return err == SDP_PARSE_OK ? 0 : -1;
+}
+
+/* a specific parser taking any parameters as they are, noting the names of
+ * the attributes it is handed */
+static enum sdp_parse_err parse_names_note(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a, char *attr,
+		char *value, char *params, void *ctx)
+{
+	strcat((char*)ctx, attr);
+	strcat((char*)ctx, " ");
+	return SDP_PARSE_OK;
+}
+
+/* attribute names are told apart from names sharing their length and first
+ * character, and from known names at the wrong level */
+static int test_attr_names(void)
+{
+	static char *names =
 		"v=0\n"
-		"o=- 123456 11 IN IP4 192.168.100.2\n"
-		"s=Example of a SMPTE ST2110-20 signal\n"
-		"i=this example is for 720p video at 59.94\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=names\n"
 		"t=0 0\n"
+		"a=group:DUP v w\n"
+		"a=mid:session\n"
+		"a=group2:DUP\n"
 		"a=recvonly\n"
-		"a=group:DUP primary secondary\n"
-		"m=video 50000 RTP/AVP 112\n"
-		"c=IN IP4 239.100.9.10/32\n"
-		"a=source-filter:incl IN IP4 239.100.9.10 192.168.100.2\n"
-		"a=rtpmap:112 raw/90000\n"
-		"a=fmtp:112 sampling=YCbCr-4:2:2; width=1280; height=720; "
-			"exactframerate=60000/1001; depth=10; TCS=SDR; "
-			"colorimetry=BT709; PM=2110GPM; TP=2110TPN; "
-			"SSN=ST2110-20:2017; \n"
-		"a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:37\n"
-		"a=mediaclk:direct=0\n"
-		"a=mid:primary\n"
-		"m=video 50020 RTP/AVP 112\n"
-		"c=IN IP4 239.101.9.10/32\n"
-		"a=source-filter:incl IN IP4 239.101.9.10 192.168.101.2\n"
+		"m=video 50000 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.1/32\n"
+		"a=mix:v\n"
+		"a=fmtq:96 x=1\n"
+		"a=rtpmap:96 raw/90000\n"
+		"a=rtpmaps:96\n"
+		"a=fmtp:96 x=1\n"
+		"a=group:DUP v w\n"
+		"a=source-filter:incl IN IP4 239.0.0.1 10.0.0.1\n"
+		"a=source-filtre:incl IN IP4 239.0.0.1 10.0.0.2\n"
+		"a=mid:v\n";
+	struct sdp_session *session = NULL;
+	struct sdp_media *media;
+	struct sdp_attr *a;
+	char noted[64];
+	int ret = 0;
+	int is_lazy;
+
+	for (is_lazy = 0; is_lazy < 2; is_lazy++) {
+		noted[0] = 0;
+		CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, names)));
+		session->is_lazy = is_lazy;
+		CHECK(sdp_session_parse(session, parse_names_note, noted) ==
+			SDP_PARSE_OK);
+
+		/* only group is kept at the session level, and group is the
+		 * one not kept at the media level */
+		CHECK(session->a_count == 1);
+		CHECK((media = sdp_media_get_mid(session, "v")));
+		CHECK(media->a_count == 4);
+		CHECK(!sdp_media_get_mid(session, "session"));
+
+		CHECK((a = sdp_media_attr_get(media, SDP_ATTR_RTPMAP)) &&
+			a->type == SDP_ATTR_RTPMAP);
+		CHECK((a = sdp_media_attr_get(media, SDP_ATTR_SOURCE_FILTER)) &&
+			a->type == SDP_ATTR_SOURCE_FILTER);
+		CHECK(!a->next_type);
+
+		/* the specific parser is handed group and fmtp only, as they
+		 * are decoded */
+		if (!is_lazy)
+			CHECK(!strcmp(noted, "group fmtp "));
+
+		sdp_parser_uninit(session);
+		session = NULL;
+	}
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	return ret;
+}
+
+/* the extractor is handed a session parsed without is_addr_text, as the
+ * watcher and the loader make them */
+static int test_extractor_session(void)
+{
+	struct sdp_session *session;
+	sdp_extractor_t e = NULL;
+	size_t len;
+	char *buf;
+	int ret = 0;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	session = sdp_parser_init_push(smpte2110_sdp_parse_specific, NULL);
+	CHECK(session);
+	CHECK(sdp_parser_feed(session, buf, len) == SDP_PARSE_OK);
+	CHECK(sdp_parser_finish(session) == SDP_PARSE_OK);
+	CHECK(!session->is_addr_text);
+
+	CHECK((e = sdp_extractor_init_session(session)));
+	CHECK(sdp_extractor_get_stream_num(e) == 2);
+	CHECK(!strcmp(sdp_extractor_get_src_ip(e, 0), "192.168.30.202"));
+	CHECK(!strcmp(sdp_extractor_get_dst_ip(e, 0), "239.20.186.1"));
+	CHECK(sdp_extractor_get_dst_port(e, 0) == 50020);
+	CHECK(!strcmp(sdp_extractor_get_src_ip(e, 1), "192.168.120.186"));
+	CHECK(!strcmp(sdp_extractor_get_dst_ip(e, 1), "239.120.186.1"));
+	CHECK(sdp_extractor_get_dst_port(e, 1) == 50120);
+
+exit:
+	if (e)
+		sdp_extractor_uninit(e);
+	if (session)
+		sdp_parser_uninit(session);
+	free(buf);
+	return ret;
+}
+
+static void watcher_count(sdp_watcher_t watcher,
+		enum sdp_watcher_event event, struct sdp_watcher_entry *entry,
+		void *ctx)
+{
+	(*(int*)ctx)++;
+}
+
+static int test_watcher(void)
+{
+	char dir[] = "/tmp/sdp_test_XXXXXX";
+	char path[sizeof(dir) + 16];
+	struct sdp_watcher_entry *entry;
+	struct sdp_media *media;
+	sdp_watcher_t w = NULL;
+	int events = 0;
+	size_t len;
+	char *buf;
+	FILE *f;
+	int ret = 0;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	path[0] = 0;
+	CHECK(mkdtemp(dir));
+	snprintf(path, sizeof(path), "%s/ias.sdp", dir);
+	CHECK((f = fopen(path, "w")));
+	CHECK(fwrite(buf, 1, len, f) == len);
+	CHECK(!fclose(f));
+
+	CHECK((w = sdp_watcher_init(dir, watcher_count, &events)));
+	CHECK(events == 1);
+	CHECK((entry = sdp_watcher_get(w, "ias.sdp")));
+	CHECK(entry->err == SDP_PARSE_OK && entry->session);
+
+	/* the extraction results */
+	CHECK(entry->extractor);
+	CHECK(!strcmp(sdp_extractor_get_src_ip(entry->extractor, 0),
+		"192.168.30.202"));
+	CHECK(!strcmp(sdp_extractor_get_dst_ip(entry->extractor, 1),
+		"239.120.186.1"));
+
+	/* and the session's addresses, as text */
+	CHECK((media = sdp_media_get(entry->session, SDP_MEDIA_TYPE_VIDEO)));
+	CHECK(media->c.sdp_ci_addr &&
+		!strcmp(media->c.sdp_ci_addr, "239.20.186.1"));
+
+exit:
+	if (w)
+		sdp_watcher_uninit(w);
+	unlink(path);
+	rmdir(dir);
+	free(buf);
+	return ret;
+}
+
+/* the accessor results of a description, parsed with the modes set */
+
+static char *mode_dump(char *sdp, int is_lazy, int is_parallel)
+{
+	struct sdp_session *session;
+	char *dump = NULL;
+
+	if (!(session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, sdp)))
+		return NULL;
+
+	session->is_lazy = is_lazy;
+	session->is_parallel = is_parallel;
+	if (sdp_session_parse(session, smpte2110_sdp_parse_specific, NULL) ==
+			SDP_PARSE_OK) {
+		dump = session_dump(session);
+	}
+
+	sdp_parser_uninit(session);
+	return dump;
+}
+
+/* files are loaded as they parse one at a time, through either path */
+static int test_load(void)
+{
+	static char *bad = "v=0\nx=unknown\n";
+	static unsigned int flags[] = { 0, SDP_LOAD_PREAD };
+	char dir[] = "/tmp/sdp_test_XXXXXX";
+	char paths[3][sizeof(dir) + 16];
+	char *files[3] = { paths[0], paths[1], paths[2] };
+	struct sdp_load_result results[3] = { { 0 } };
+	char *expected = NULL;
+	char *dump = NULL;
+	size_t len;
+	char *buf;
+	FILE *f;
+	int ret = 0;
+	int i;
+	int j;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	paths[0][0] = paths[1][0] = paths[2][0] = 0;
+	CHECK((expected = mode_dump(buf, 0, 0)));
+	CHECK(mkdtemp(dir));
+	snprintf(paths[0], sizeof(paths[0]), "%s/ias.sdp", dir);
+	snprintf(paths[1], sizeof(paths[1]), "%s/bad.sdp", dir);
+	snprintf(paths[2], sizeof(paths[2]), "%s/missing.sdp", dir);
+	CHECK((f = fopen(paths[0], "w")));
+	CHECK(fwrite(buf, 1, len, f) == len);
+	CHECK(!fclose(f));
+	CHECK((f = fopen(paths[1], "w")));
+	CHECK(fputs(bad, f) >= 0);
+	CHECK(!fclose(f));
+
+	for (i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+		CHECK(sdp_load(files, 3, smpte2110_sdp_parse_specific, NULL,
+			results, flags[i]) == 1);
+
+		CHECK(results[0].err == SDP_PARSE_OK && results[0].session);
+		CHECK((dump = session_dump(results[0].session)));
+		CHECK(!strcmp(dump, expected));
+		free(dump);
+		dump = NULL;
+
+		CHECK(results[1].err != SDP_PARSE_OK && !results[1].session);
+		CHECK(results[2].err == SDP_PARSE_ERROR &&
+			!results[2].session);
+
+		for (j = 0; j < 3; j++) {
+			if (results[j].session)
+				sdp_parser_uninit(results[j].session);
+			results[j].session = NULL;
+		}
+	}
+
+exit:
+	for (j = 0; j < 3; j++) {
+		if (results[j].session)
+			sdp_parser_uninit(results[j].session);
+	}
+	unlink(paths[0]);
+	unlink(paths[1]);
+	rmdir(dir);
+	free(dump);
+	free(expected);
+	free(buf);
+	return ret;
+}
+
+/* descriptions parsed over the pool each come out as if parsed alone, a bad
+ * one failing at its own index only */
+static int test_parse_batch(void)
+{
+	static char *bad = "v=0\nx=unknown\n";
+	struct sdp_load_result results[64] = { { 0 } };
+	struct sdp_profile *profile = NULL;
+	char *inputs[64];
+	char *expected[2] = { NULL };
+	char *dump = NULL;
+	size_t len;
+	char *buf;
+	int ret = 0;
+	int i;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	CHECK((expected[0] = mode_dump(buf, 0, 0)));
+	CHECK((expected[1] = mode_dump(sdp, 0, 0)));
+	CHECK((profile = sdp_profile_create()));
+	CHECK(!smpte2110_sdp_profile_register(profile));
+
+	for (i = 0; i < 64; i++)
+		inputs[i] = i == 17 ? bad : i % 2 ? sdp : buf;
+
+	CHECK(!sdp_parse_batch(inputs, 0, profile, results));
+	CHECK(sdp_parse_batch(inputs, 64, profile, results) == 63);
+	for (i = 0; i < 64; i++) {
+		if (i == 17) {
+			CHECK(results[i].err != SDP_PARSE_OK &&
+				!results[i].session);
+			continue;
+		}
+
+		CHECK(results[i].err == SDP_PARSE_OK && results[i].session);
+		CHECK((dump = session_dump(results[i].session)));
+		CHECK(!strcmp(dump, expected[i % 2]));
+		free(dump);
+		dump = NULL;
+	}
+
+exit:
+	for (i = 0; i < 64; i++) {
+		if (results[i].session)
+			sdp_parser_uninit(results[i].session);
+	}
+	if (profile)
+		sdp_profile_destroy(profile);
+	free(dump);
+	free(expected[0]);
+	free(expected[1]);
+	free(buf);
+	return ret;
+}
+
+/* counts the attributes it is handed */
+static enum sdp_parse_err parse_count(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a, char *attr,
+		char *value, char *params, void *ctx)
+{
+	(*(int*)ctx)++;
+	return SDP_PARSE_OK;
+}
+
+/* profiles parse as the specific parser does, and hand each registered
+ * attribute to the parser of its level and media type */
+static int test_profile(void)
+{
+	static char *notes =
+		"v=0\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=notes\n"
+		"t=0 0\n"
+		"a=x-note:session\n"
+		"m=video 50000 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.1/32\n"
+		"a=x-note:video\n"
+		"a=x-other:video\n"
+		"a=x-39:video\n"
+		"m=audio 50010 RTP/AVP 97\n"
+		"c=IN IP4 239.0.0.2/32\n"
+		"a=x-note:audio\n"
+		"a=x-39:audio\n";
+	struct sdp_profile *profile = NULL;
+	struct sdp_session *session = NULL;
+	struct sdp_media *media;
+	struct sdp_attr *a;
+	char *expected = NULL;
+	char *dump = NULL;
+	char name[8];
+	int counts[4] = { 0 };
+	size_t len;
+	char *buf;
+	int ret = 0;
+	int i;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	/* the SMPTE ST2110 profile, parsing and pushed */
+	CHECK((expected = mode_dump(buf, 0, 0)));
+	CHECK((profile = sdp_profile_create()));
+	CHECK(!smpte2110_sdp_profile_register(profile));
+
+	CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, buf)));
+	CHECK(sdp_session_parse_profile(session, profile) == SDP_PARSE_OK);
+	CHECK((dump = session_dump(session)));
+	CHECK(!strcmp(dump, expected));
+	free(dump);
+	dump = NULL;
+	sdp_parser_uninit(session);
+
+	CHECK((session = sdp_parser_init_push_profile(profile)));
+	CHECK(sdp_parser_feed(session, buf, len) == SDP_PARSE_OK);
+	CHECK(sdp_parser_finish(session) == SDP_PARSE_OK);
+	CHECK((dump = session_dump(session)));
+	CHECK(!strcmp(dump, expected));
+	sdp_parser_uninit(session);
+	session = NULL;
+	sdp_profile_destroy(profile);
+
+	/* attributes of its own, per level and media type */
+	CHECK((profile = sdp_profile_create()));
+	CHECK(sdp_profile_register(profile, "", SDP_MEDIA_TYPE_NONE,
+		parse_count, &counts[0]) == -1);
+	CHECK(sdp_profile_register(profile, "x-note", SDP_MEDIA_TYPE_NONE,
+		NULL, &counts[0]) == -1);
+	CHECK(!sdp_profile_register(profile, "x-note", SDP_MEDIA_TYPE_NONE,
+		parse_count, &counts[0]));
+	CHECK(!sdp_profile_register(profile, "x-note", SDP_MEDIA_TYPE_AUDIO,
+		parse_count, &counts[1]));
+	CHECK(!sdp_profile_register(profile, "x-note", SDP_MEDIA_TYPE_VIDEO,
+		parse_count, &counts[1]));
+	/* a later registration replaces an earlier one */
+	CHECK(!sdp_profile_register(profile, "x-note", SDP_MEDIA_TYPE_VIDEO,
+		parse_count, &counts[2]));
+	/* the profile grows past its initial size */
+	for (i = 0; i < 40; i++) {
+		snprintf(name, sizeof(name), "x-%d", i);
+		CHECK(!sdp_profile_register(profile, name,
+			SDP_MEDIA_TYPE_VIDEO, parse_count, &counts[3]));
+	}
+
+	CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, notes)));
+	CHECK(sdp_session_parse_profile(session, profile) == SDP_PARSE_OK);
+	CHECK(counts[0] == 1 && counts[1] == 1 && counts[2] == 1 &&
+		counts[3] == 1);
+
+	CHECK(session->a_count == 1);
+	CHECK(session->a->type == SDP_ATTR_SPECIFIC);
+	CHECK((media = sdp_media_get(session, SDP_MEDIA_TYPE_VIDEO)));
+	CHECK(media->a_count == 2);
+	for (a = media->a; a; a = a->next)
+		CHECK(a->type == SDP_ATTR_SPECIFIC);
+	CHECK((media = sdp_media_get(session, SDP_MEDIA_TYPE_AUDIO)));
+	CHECK(media->a_count == 1);
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	if (profile)
+		sdp_profile_destroy(profile);
+	free(dump);
+	free(expected);
+	free(buf);
+	return ret;
+}
+
+/* media and attributes are laid out in document order in the flat arrays,
+ * for streams that can be peeked */
+static int test_flat(void)
+{
+	struct sdp_session *session = NULL;
+	struct sdp_media *media;
+	struct sdp_attr *a;
+	size_t attr_count;
+	size_t len;
+	char *buf;
+	int ret = 0;
+	int is_lazy;
+	size_t i;
+	size_t j;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	for (is_lazy = 0; is_lazy < 2; is_lazy++) {
+		CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, buf)));
+		session->is_lazy = is_lazy;
+		CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific,
+			NULL) == SDP_PARSE_OK);
+		CHECK(session->media_flat && session->attr_flat);
+		CHECK(session->media_count == 2);
+
+		/* the session's attributes lead */
+		CHECK(!session->a_count || session->a == session->attr_flat);
+		for (a = session->a, j = 0; a; a = a->next, j++)
+			CHECK(a == &session->attr_flat[j]);
+		CHECK(j == session->a_count);
+		attr_count = j;
+
+		for (media = session->media, i = 0; media;
+				media = media->next, i++) {
+			CHECK(i < session->media_count);
+			CHECK(media == &session->media_flat[i]);
+			CHECK(media->a_offset == attr_count);
+			for (a = media->a, j = 0; a; a = a->next, j++) {
+				CHECK(a == session->attr_flat +
+					media->a_offset + j);
+			}
+			CHECK(j == media->a_count);
+			attr_count += j;
+		}
+		CHECK(i == session->media_count);
+		CHECK(attr_count == session->attr_count);
+
+		sdp_parser_uninit(session);
+		session = NULL;
+	}
+
+	/* a push session, not counted beforehand, is not laid out flat */
+	CHECK((session = sdp_parser_init_push(smpte2110_sdp_parse_specific,
+		NULL)));
+	CHECK(sdp_parser_feed(session, buf, len) == SDP_PARSE_OK);
+	CHECK(sdp_parser_finish(session) == SDP_PARSE_OK);
+	CHECK(!session->media_flat && !session->attr_flat);
+	CHECK(session->media && session->media->next);
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	free(buf);
+	return ret;
+}
+
+/* lazy sessions report what eager ones do, parallel ones included */
+static int test_lazy(void)
+{
+	static char *media =
+		"m=video %d RTP/AVP 112\n"
+		"c=IN IP4 239.100.%d.%d/32\n"
+		"a=source-filter:incl IN IP4 239.100.%d.%d 192.168.100.2\n"
 		"a=rtpmap:112 raw/90000\n"
-		"a=fmtp:112 sampling=YCbCr-4:2:2; width=1280; height=720; "
-			"exactframerate=60000/1001; depth=10; TCS=SDR; "
+		"a=fmtp:112 sampling=YCbCr-4:2:2; width=%d; height=1080; "
+			"exactframerate=50; depth=10; TCS=SDR; "
 			"colorimetry=BT709; PM=2110GPM; TP=2110TPN; "
 			"SSN=ST2110-20:2017; \n"
-		"a=ts-refclk:ptp=IEEE1588-2008:39-A7-94-FF-FE-07-CB-D0:37\n"
-		"a=mediaclk:direct=0\n"
-		"a=mid:secondary\n";
+		"a=mid:m%d\n";
+	char *docs[] = { sdp, NULL, NULL };
+	char *dumps[4] = { NULL };
+	size_t size;
+	size_t len;
+	FILE *f;
+	int ret = 0;
+	int i;
+	int j;
 
-	session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, sdp);
-	if (!session) {
-		printf("failed to initialize sdp session\n");
+	CHECK((docs[1] = example_read(&len)));
+
+	/* enough media blocks to be parsed in parallel */
+	CHECK((f = open_memstream(&docs[2], &size)));
+	fprintf(f, "v=0\n"
+		"o=- 1 1 IN IP4 192.168.100.2\n"
+		"s=lazy\n"
+		"t=0 0\n"
+		"a=group:DUP m0 m1\n");
+	for (i = 0; i < 100; i++) {
+		fprintf(f, media, 50000 + 2 * i, i >> 8, i & 0xff, i >> 8,
+			i & 0xff, 1280 + i, i);
+	}
+	CHECK(!fclose(f));
+
+	for (i = 0; i < 3; i++) {
+		/* eager, lazy, parallel and both */
+		for (j = 0; j < 4; j++)
+			CHECK((dumps[j] = mode_dump(docs[i], j & 1, j & 2)));
+
+		for (j = 1; j < 4; j++) {
+			if (strcmp(dumps[j], dumps[0])) {
+				printf("document %d, lazy %d parallel %d:\n"
+					"%s\n", i, j & 1, !!(j & 2),
+					dumps[j]);
+			}
+			CHECK(!strcmp(dumps[j], dumps[0]));
+		}
+
+		for (j = 0; j < 4; j++) {
+			free(dumps[j]);
+			dumps[j] = NULL;
+		}
+	}
+
+exit:
+	for (j = 0; j < 4; j++)
+		free(dumps[j]);
+	free(docs[1]);
+	free(docs[2]);
+	return ret;
+}
+
+/* an attribute in error fails an eager parse, and a lazy one once it is
+ * looked for, leaving the others readable */
+static int test_lazy_error(void)
+{
+	static char *doc =
+		"v=0\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=lazy error\n"
+		"t=0 0\n"
+		"m=video 50000 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.1/32\n"
+		"a=rtpmap:96 raw\n"
+		"a=mid:m\n"
+		"m=video 50002 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.2/32\n"
+		"a=fmtp:96 sampling=YCbCr-4:2:2\n"
+		"a=mid:n\n";
+	struct sdp_session *session = NULL;
+	struct sdp_media *media;
+	struct sdp_attr *a;
+	int is_lazy;
+	int ret = 0;
+
+	for (is_lazy = 0; is_lazy < 2; is_lazy++) {
+		CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, doc)));
+		session->is_lazy = is_lazy;
+		if (!is_lazy) {
+			CHECK(sdp_session_parse(session,
+				smpte2110_sdp_parse_specific, NULL) ==
+				SDP_PARSE_ERROR);
+			sdp_parser_uninit(session);
+			session = NULL;
+			continue;
+		}
+
+		CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific,
+			NULL) == SDP_PARSE_OK);
+		CHECK((media = sdp_media_get_mid(session, "m")));
+		CHECK(!sdp_media_attr_get(media, SDP_ATTR_RTPMAP));
+		CHECK(media->a->type == SDP_ATTR_NOT_SUPPORTED);
+		CHECK((a = sdp_media_attr_get(media, SDP_ATTR_MID)) &&
+			a->type == SDP_ATTR_MID);
+
+		/* an a=fmtp without an a=rtpmap is left untyped, which does
+		 * not hide the tag of its media */
+		CHECK((media = sdp_media_get_mid(session, "n")));
+		CHECK(media->m.port == 50002);
+		CHECK((a = sdp_media_attr_get(media, SDP_ATTR_FMTP)) &&
+			a->type == SDP_ATTR_NONE);
+
+		sdp_parser_uninit(session);
+		session = NULL;
+	}
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	return ret;
+}
+
+/* a specific parser supporting no attribute */
+static enum sdp_parse_err parse_none(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a, char *attr,
+		char *value, char *params, void *ctx)
+{
+	return SDP_PARSE_NOT_SUPPORTED;
+}
+
+/* source-filters are looked up by binary source address */
+static int test_source_allowed(void)
+{
+	static char *undecodable =
+		"v=0\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=undecodable source filter\n"
+		"t=0 0\n"
+		"m=video 50000 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.1/32\n"
+		"a=source-filter:incl IN IP4\n";
+	struct sdp_session *session = NULL;
+	struct sdp_media *media[5];
+	struct in6_addr ip6;
+	struct in_addr ip4;
+	char *doc = NULL;
+	char src[32];
+	size_t size;
+	int is_lazy;
+	FILE *f;
+	int ret = 0;
+	int i;
+
+	CHECK((f = open_memstream(&doc, &size)));
+	fprintf(f, "v=0\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=source filters\n"
+		"t=0 0\n"
+		"m=video 50000 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.1/32\n"
+		"a=source-filter:incl IN IP4 239.0.0.1");
+	for (i = 1; i <= 40; i++)
+		fprintf(f, " 10.0.0.%d", i);
+	fprintf(f, "\n"
+		"m=video 50002 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.2/32\n"
+		"a=source-filter:excl IN IP4 * 10.0.1.1 host.example\n"
+		"m=video 50004 RTP/AVP 96\n"
+		"c=IN IP6 ff0e::1\n"
+		"a=source-filter:incl IN IP6 ff0e::1 2001:db8::1 2001:db8::2\n"
+		"m=video 50006 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.4/32\n"
+		"m=video 50008 RTP/AVP 96\n"
+		"c=IN IP4 239.1.1.1/32\n"
+		"a=fmtp:96 x=1\n"
+		"a=source-filter:incl IN IP4 239.1.1.1 10.0.0.1\n");
+	CHECK(!fclose(f));
+
+	for (is_lazy = 0; is_lazy < 2; is_lazy++) {
+		CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, doc)));
+		session->is_lazy = is_lazy;
+		CHECK(sdp_session_parse(session, parse_none, NULL) ==
+			SDP_PARSE_OK);
+
+		media[0] = sdp_media_get(session, SDP_MEDIA_TYPE_VIDEO);
+		for (i = 1; i < 5; i++) {
+			CHECK(media[i - 1]);
+			media[i] = sdp_media_get_next(media[i - 1]);
+		}
+		CHECK(media[4]);
+
+		/* incl, of many sources */
+		for (i = 1; i <= 41; i++) {
+			snprintf(src, sizeof(src), "10.0.0.%d", i);
+			inet_pton(AF_INET, src, &ip4);
+			CHECK(sdp_media_source_allowed(media[0],
+				SDP_CI_ADDRTYPE_IPV4, &ip4) == (i <= 40));
+		}
+		inet_pton(AF_INET6, "::ffff:10.0.0.1", &ip6);
+		CHECK(!sdp_media_source_allowed(media[0],
+			SDP_CI_ADDRTYPE_IPV6, &ip6));
+
+		/* excl to any destination, names match no source */
+		inet_pton(AF_INET, "10.0.1.1", &ip4);
+		CHECK(!sdp_media_source_allowed(media[1],
+			SDP_CI_ADDRTYPE_IPV4, &ip4));
+		inet_pton(AF_INET, "10.0.1.2", &ip4);
+		CHECK(sdp_media_source_allowed(media[1],
+			SDP_CI_ADDRTYPE_IPV4, &ip4));
+
+		/* IPv6 sources */
+		inet_pton(AF_INET6, "2001:db8::2", &ip6);
+		CHECK(sdp_media_source_allowed(media[2],
+			SDP_CI_ADDRTYPE_IPV6, &ip6));
+		inet_pton(AF_INET6, "2001:db8::3", &ip6);
+		CHECK(!sdp_media_source_allowed(media[2],
+			SDP_CI_ADDRTYPE_IPV6, &ip6));
+		inet_pton(AF_INET, "10.0.0.1", &ip4);
+		CHECK(!sdp_media_source_allowed(media[2],
+			SDP_CI_ADDRTYPE_IPV4, &ip4));
+
+		/* no source-filter, any source */
+		CHECK(sdp_media_source_allowed(media[3],
+			SDP_CI_ADDRTYPE_IPV4, &ip4));
+
+		/* led by an attribute the specific parser left untyped */
+		CHECK(sdp_media_source_allowed(media[4],
+			SDP_CI_ADDRTYPE_IPV4, &ip4));
+		inet_pton(AF_INET, "10.9.9.9", &ip4);
+		CHECK(!sdp_media_source_allowed(media[4],
+			SDP_CI_ADDRTYPE_IPV4, &ip4));
+
+		sdp_parser_uninit(session);
+		session = NULL;
+	}
+
+	/* a source-filter a lazy parse cannot decode lets no source through */
+	CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, undecodable)));
+	session->is_lazy = 1;
+	CHECK(sdp_session_parse(session, NULL, NULL) == SDP_PARSE_OK);
+	CHECK((media[0] = sdp_media_get(session, SDP_MEDIA_TYPE_VIDEO)));
+	CHECK(!sdp_media_source_allowed(media[0], SDP_CI_ADDRTYPE_IPV4,
+		&ip4));
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	free(doc);
+	return ret;
+}
+
+/* a push session over a buffer fed in chunks of chunk bytes, finished
+ * unless chunk is 0 */
+static struct sdp_session *push_parse(const char *buf, size_t len,
+		size_t chunk, enum sdp_parse_err *err)
+{
+	struct sdp_session *session;
+	size_t offset;
+
+	session = sdp_parser_init_push(smpte2110_sdp_parse_specific, NULL);
+	if (!session)
+		return NULL;
+
+	for (offset = 0, *err = SDP_PARSE_OK; offset < len &&
+			*err == SDP_PARSE_OK; offset += chunk) {
+		*err = sdp_parser_feed(session, buf + offset,
+			len - offset < chunk ? len - offset : chunk);
+	}
+
+	if (*err == SDP_PARSE_OK)
+		*err = sdp_parser_finish(session);
+
+	return session;
+}
+
+/* a reset session parses another description the same, without allocating
+ * once it has grown to fit */
+static int test_reset(void)
+{
+	struct sdp_session *session = NULL;
+	struct sdp_session *borrowed = NULL;
+	sdp_stream_t stream = NULL;
+	enum sdp_parse_err err;
+	char *expected = NULL;
+	char *dump = NULL;
+	size_t len;
+	char *buf;
+	int ret = 0;
+	int i;
+
+	if (!(buf = example_read(&len)))
 		return -1;
+
+	CHECK((expected = mode_dump(buf, 0, 0)));
+
+	/* the stream is reopened on the first description, then on another */
+	CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, sdp)));
+	CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific, NULL) ==
+		SDP_PARSE_OK);
+	for (i = 0; i < 3; i++) {
+		CHECK(!sdp_session_reset(session, buf));
+		CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific,
+			NULL) == SDP_PARSE_OK);
 	}
+	CHECK((dump = session_dump(session)));
+	CHECK(!strcmp(dump, expected));
+	free(dump);
+	dump = NULL;
 
-	err = sdp_session_parse(session, smpte2110_sdp_parse_specific);
-	printf("parsing result: %s\n", err2str[err]);
+	alloc_count = 0;
+	is_alloc_counted = 1;
+	err = sdp_session_reset(session, buf) ? SDP_PARSE_ERROR :
+		sdp_session_parse(session, smpte2110_sdp_parse_specific, NULL);
+	is_alloc_counted = 0;
+	CHECK(err == SDP_PARSE_OK);
+	CHECK(!alloc_count);
+	CHECK(sdp_media_get_mid(session, "primary"));
 
 	sdp_parser_uninit(session);
+	session = NULL;
+
+	/* a borrowed stream is only reopened by its owner */
+	CHECK((stream = sdp_stream_open(SDP_STREAM_TYPE_CHAR, buf)));
+	CHECK((borrowed = sdp_parser_init_stream(stream)));
+	CHECK(sdp_session_reset(borrowed, sdp) == -1);
+
+	/* a push session is fed again */
+	CHECK((session = push_parse(sdp, strlen(sdp), 64, &err)));
+	CHECK(err == SDP_PARSE_OK);
+	CHECK(!sdp_session_reset(session, NULL));
+	CHECK(sdp_parser_feed(session, buf, len) == SDP_PARSE_OK);
+	CHECK(sdp_parser_finish(session) == SDP_PARSE_OK);
+	CHECK((dump = session_dump(session)));
+	CHECK(!strcmp(dump, expected));
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	if (borrowed)
+		sdp_parser_uninit(borrowed);
+	if (stream)
+		sdp_stream_close(stream);
+	free(dump);
+	free(expected);
+	free(buf);
+	return ret;
+}
+
+/* the example parses the same fed in chunks of any size */
+static int test_push_chunks(void)
+{
+	struct sdp_session *session = NULL;
+	enum sdp_parse_err err;
+	char *reference = NULL;
+	char *dump = NULL;
+	size_t chunk;
+	size_t len;
+	char *buf;
+	int ret = 0;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, buf);
+	CHECK(session);
+	CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific, NULL) ==
+		SDP_PARSE_OK);
+	CHECK((reference = session_dump(session)));
+	sdp_parser_uninit(session);
+	session = NULL;
+
+	for (chunk = 1; chunk <= len; chunk++) {
+		session = push_parse(buf, len, chunk, &err);
+		CHECK(session);
+		CHECK(err == SDP_PARSE_OK);
+
+		CHECK((dump = session_dump(session)));
+		if (strcmp(dump, reference))
+			printf("chunks of %zu bytes:\n%s\n", chunk, dump);
+		CHECK(!strcmp(dump, reference));
+
+		free(dump);
+		dump = NULL;
+		sdp_parser_uninit(session);
+		session = NULL;
+	}
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	free(reference);
+	free(dump);
+	free(buf);
+	return ret;
+}
+
+static int test_push_edges(void)
+{
+	static char *eos =
+		"v=0\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=empty line\n"
+		"t=0 0\n"
+		"m=video 50000 RTP/AVP 96\n"
+		"c=IN IP4 239.0.0.1/32\n"
+		"\n"
+		"this is not a description\n";
+	static char *unterminated =
+		"v=0\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=unterminated\n"
+		"t=0 0\n"
+		"m=video 50000 RTP/AVP 96\n"
+		"a=mid:last";
+	static char *broken =
+		"v=0\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=broken\n"
+		"t=0 0\n"
+		"m=video 50000 RTP/AVP 96\n"
+		"garbage\n"
+		"a=mid:after\n";
+	struct sdp_session *session = NULL;
+	enum sdp_parse_err err;
+	struct sdp_media *media;
+	struct sdp_attr *a;
+	int ret = 0;
+
+	/* lines past an empty one are not parsed, feeding them is not an
+	 * error */
+	CHECK((session = push_parse(eos, strlen(eos), 7, &err)));
+	CHECK(err == SDP_PARSE_OK);
+	CHECK((media = sdp_media_get(session, SDP_MEDIA_TYPE_VIDEO)));
+	CHECK(!media->next && media->c.count == 1);
+	CHECK(sdp_parser_feed(session, "m=audio 1 RTP/AVP 0\n", 20) ==
+		SDP_PARSE_ERROR);
+	sdp_parser_uninit(session);
+
+	/* the last line is parsed on finishing, whatever the chunks */
+	CHECK((session = push_parse(unterminated, strlen(unterminated),
+		strlen(unterminated), &err)));
+	CHECK(err == SDP_PARSE_OK);
+	CHECK((media = sdp_media_get_mid(session, "last")));
+	sdp_parser_uninit(session);
+
+	CHECK((session = push_parse(unterminated, strlen(unterminated), 4,
+		&err)));
+	CHECK(err == SDP_PARSE_OK);
+	CHECK((media = sdp_media_get_mid(session, "last")));
+	sdp_parser_uninit(session);
+
+	/* an error in the middle of a chunk stops parsing there, later
+	 * chunks and finishing report it */
+	session = sdp_parser_init_push(smpte2110_sdp_parse_specific, NULL);
+	CHECK(session);
+	CHECK(sdp_parser_feed(session, broken, strlen(broken)) ==
+		SDP_PARSE_ERROR);
+	CHECK(sdp_parser_feed(session, "a=mid:later\n", 12) ==
+		SDP_PARSE_ERROR);
+	CHECK(sdp_parser_finish(session) == SDP_PARSE_ERROR);
+	CHECK((media = session->media));
+	CHECK(!(a = sdp_media_attr_get(media, SDP_ATTR_MID)));
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	return ret;
+}
+
+/* compacted sessions keep their description and nothing else */
+static int test_compact(void)
+{
+	struct sdp_session *session = NULL;
+	char *reference = NULL;
+	char *dump = NULL;
+	size_t usage;
+	size_t len;
+	char *buf;
+	int is_lazy;
+	int ret = 0;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	for (is_lazy = 0; is_lazy < 2; is_lazy++) {
+		CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_MMAP,
+			EXAMPLE)));
+		session->is_lazy = is_lazy;
+		CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific,
+			NULL) == SDP_PARSE_OK);
+		usage = sdp_session_memory_usage(session);
+
+		/* lazy attributes are decoded once compacted */
+		if (!is_lazy)
+			CHECK((reference = session_dump(session)));
+
+		CHECK(!sdp_session_compact(session));
+		CHECK(sdp_session_memory_usage(session) < usage);
+		CHECK(!session->sdp);
+		CHECK(is_lazy || !session->parser);
+
+		CHECK((dump = session_dump(session)));
+		CHECK(!strcmp(dump, reference));
+		free(dump);
+		dump = NULL;
+
+		CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific,
+			NULL) == SDP_PARSE_ERROR);
+		CHECK(sdp_parser_feed(session, buf, len) == SDP_PARSE_ERROR);
+
+		sdp_parser_uninit(session);
+		session = NULL;
+	}
+
+	/* push sessions once finished */
+	CHECK((session = sdp_parser_init_push(smpte2110_sdp_parse_specific,
+		NULL)));
+	CHECK(sdp_parser_feed(session, buf, len / 2) == SDP_PARSE_OK);
+	CHECK(sdp_session_compact(session) == -1);
+	CHECK(sdp_parser_feed(session, buf + len / 2, len - len / 2) ==
+		SDP_PARSE_OK);
+	CHECK(sdp_parser_finish(session) == SDP_PARSE_OK);
+	CHECK(!sdp_session_compact(session));
+	CHECK((dump = session_dump(session)));
+	CHECK(!strcmp(dump, reference));
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	free(reference);
+	free(dump);
+	free(buf);
+	return ret;
+}
+
+/* the lines of a stream are views of buf, laid out contiguously from *base
+ * on, and nothing else */
+static int stream_lines_check(sdp_stream_t stream, const char *buf,
+		size_t len, const char **base)
+{
+	const char *line;
+	size_t offset = 0;
+	ssize_t n;
+	int ret = 0;
+
+	*base = NULL;
+	while ((n = sdp_stream_getline_view(&line, stream)) > 0) {
+		if (!*base)
+			*base = line;
+
+		CHECK(line == *base + offset);
+		CHECK(offset + n <= len && !memcmp(line, buf + offset, n));
+		CHECK(line[n - 1] == '\n' || offset + n == len);
+		offset += n;
+	}
+
+	CHECK(!n && offset == len);
+
+exit:
+	return ret;
+}
+
+/* the example is read in place of its mapping */
+static int test_stream_mmap(void)
+{
+	char path[] = "/tmp/sdp_test_XXXXXX";
+	struct sdp_session *session = NULL;
+	sdp_stream_t stream = NULL;
+	char *reference = NULL;
+	char *dump = NULL;
+	const char *base;
+	const char *peek;
+	size_t len;
+	char *buf;
+	int fd = -1;
+	int ret = 0;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	CHECK((stream = sdp_stream_open(SDP_STREAM_TYPE_MMAP, EXAMPLE)));
+	CHECK(sdp_stream_peek(&peek, stream) == (ssize_t)len);
+	CHECK(!stream_lines_check(stream, buf, len, &base));
+	CHECK(base == peek);
+	CHECK(sdp_stream_peek(&peek, stream) == 0);
+	sdp_stream_close(stream);
+	stream = NULL;
+
+	/* an empty file maps to an empty stream, a missing one fails */
+	CHECK((fd = mkstemp(path)) != -1);
+	CHECK((stream = sdp_stream_open(SDP_STREAM_TYPE_MMAP, path)));
+	CHECK(sdp_stream_getline_view(&base, stream) == 0);
+	sdp_stream_close(stream);
+	stream = NULL;
+	CHECK(!sdp_stream_open(SDP_STREAM_TYPE_MMAP, "/nonexistent.sdp"));
+
+	/* and parses as the same description in memory */
+	CHECK((reference = mode_dump(buf, 0, 0)));
+	CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_MMAP, EXAMPLE)));
+	CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific, NULL) ==
+		SDP_PARSE_OK);
+	CHECK((dump = session_dump(session)));
+	CHECK(!strcmp(dump, reference));
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	if (stream)
+		sdp_stream_close(stream);
+	if (fd != -1) {
+		close(fd);
+		unlink(path);
+	}
+	free(reference);
+	free(dump);
+	free(buf);
+	return ret;
+}
+
+/* a SAP packet of version 1 announcing, or deleting, a session named s
+ * from an IPv4 or IPv6 source, with or without its payload type */
+static int sap_send(int tx, struct sockaddr_in *addr, int is_deletion,
+		int is_ipv6, uint8_t source, uint16_t msg_id_hash,
+		int is_typed, const char *s)
+{
+	char pkt[512];
+	size_t len = 0;
+
+	pkt[len++] = 1 << 5 | (is_ipv6 ? 1 << 4 : 0) |
+		(is_deletion ? 1 << 2 : 0);
+	pkt[len++] = 0;
+	pkt[len++] = msg_id_hash >> 8;
+	pkt[len++] = msg_id_hash & 0xff;
+	memset(pkt + len, 0, is_ipv6 ? 16 : 4);
+	len += is_ipv6 ? 16 : 4;
+	pkt[len - 1] = source;
+
+	if (is_typed) {
+		memcpy(pkt + len, "application/sdp", 16);
+		len += 16;
+	}
+
+	len += snprintf(pkt + len, sizeof(pkt) - len, "v=0\n"
+		"o=- 1 1 IN IP4 127.0.0.1\n"
+		"s=%s\n"
+		"t=0 0\n", s);
+
+	return sendto(tx, pkt, len, 0, (struct sockaddr*)addr,
+		sizeof(*addr)) == len ? 0 : -1;
+}
+
+/* announcements are parsed once per key, or per payload under a zero
+ * hash */
+static int test_sap(void)
+{
+	struct sdp_sap_announcement *a;
+	struct sdp_session *session;
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	sdp_sap_t sap = NULL;
+	int rx = -1;
+	int tx = -1;
+	int ret = 0;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	CHECK((rx = socket(AF_INET, SOCK_DGRAM, 0)) != -1);
+	CHECK((tx = socket(AF_INET, SOCK_DGRAM, 0)) != -1);
+	CHECK(!bind(rx, (struct sockaddr*)&addr, sizeof(addr)));
+	CHECK(!getsockname(rx, (struct sockaddr*)&addr, &addrlen));
+	CHECK((sap = sdp_sap_init(rx, NULL, NULL)));
+
+	/* queued up front, received in order */
+	CHECK(!sap_send(tx, &addr, 0, 0, 1, 0x1234, 1, "one"));
+	CHECK(!sap_send(tx, &addr, 0, 0, 1, 0x1234, 1, "one"));
+	CHECK(!sap_send(tx, &addr, 0, 0, 2, 0, 1, "two"));
+	CHECK(!sap_send(tx, &addr, 0, 0, 2, 0, 1, "two"));
+	CHECK(!sap_send(tx, &addr, 0, 0, 2, 0, 1, "three"));
+	CHECK(sendto(tx, "not SAP", 7, 0, (struct sockaddr*)&addr,
+		sizeof(addr)) == 7);
+	CHECK(!sap_send(tx, &addr, 1, 0, 1, 0x1234, 0, ""));
+	CHECK(!sap_send(tx, &addr, 0, 1, 3, 0x5678, 0, "four"));
+
+	CHECK(!sdp_sap_recv(sap, &a));
+	CHECK(a->event == SDP_SAP_EVENT_NEW && a->msg_id_hash == 0x1234);
+	CHECK(!a->is_ipv6 && a->source[3] == 1);
+	CHECK(a->err == SDP_PARSE_OK && !strcmp(a->session->s, "one"));
+	session = a->session;
+
+	/* repeats are served from the cache, not parsed again */
+	CHECK(!sdp_sap_recv(sap, &a));
+	CHECK(a->event == SDP_SAP_EVENT_REPEAT && a->session == session);
+
+	/* a zero hash is told apart by its payload */
+	CHECK(!sdp_sap_recv(sap, &a));
+	CHECK(a->event == SDP_SAP_EVENT_NEW && !a->msg_id_hash);
+	CHECK(!strcmp(a->session->s, "two"));
+	CHECK(!sdp_sap_recv(sap, &a));
+	CHECK(a->event == SDP_SAP_EVENT_REPEAT);
+	CHECK(!sdp_sap_recv(sap, &a));
+	CHECK(a->event == SDP_SAP_EVENT_CHANGED);
+	CHECK(!strcmp(a->session->s, "three"));
+
+	/* the deleted session is valid until the next receive, the packet
+	 * which is not SAP is skipped */
+	CHECK(!sdp_sap_recv(sap, &a));
+	CHECK(a->event == SDP_SAP_EVENT_DELETE && a->session == session);
+	CHECK(!strcmp(a->session->s, "one"));
+
+	/* an IPv6 source and a bare payload */
+	CHECK(!sdp_sap_recv(sap, &a));
+	CHECK(a->event == SDP_SAP_EVENT_NEW && a->is_ipv6);
+	CHECK(a->source[15] == 3 && !strcmp(a->session->s, "four"));
+
+	/* the deleted session is no longer cached */
+	CHECK(sdp_sap_expire(sap, a->last_seen + 1) == 2);
+
+exit:
+	if (sap)
+		sdp_sap_uninit(sap);
+	if (tx != -1)
+		close(tx);
+	if (rx != -1)
+		close(rx);
+	return ret;
+}
+
+/* a length bounded buffer is read in place, up to its length only */
+static int test_stream_buf(void)
+{
+	static char *past = "a=mid:past the end\n";
+	struct sdp_session *session = NULL;
+	struct sdp_stream_buf sb;
+	sdp_stream_t stream = NULL;
+	char *reference = NULL;
+	char *bounded = NULL;
+	char *dump = NULL;
+	const char *base;
+	size_t len;
+	char *buf;
+	int ret = 0;
+
+	if (!(buf = example_read(&len)))
+		return -1;
+
+	/* the last line unterminated, followed by what is not to be read */
+	CHECK(len && buf[len - 1] == '\n');
+	CHECK((bounded = (char*)malloc(len + strlen(past))));
+	memcpy(bounded, buf, len - 1);
+	memcpy(bounded + len - 1, past, strlen(past));
+	sb.buf = bounded;
+	sb.len = len - 1;
+
+	CHECK((stream = sdp_stream_open(SDP_STREAM_TYPE_BUF, &sb)));
+	CHECK(!stream_lines_check(stream, buf, len - 1, &base));
+	CHECK(base == bounded);
+	sdp_stream_close(stream);
+	stream = NULL;
+
+	sb.len = 0;
+	CHECK((stream = sdp_stream_open(SDP_STREAM_TYPE_BUF, &sb)));
+	CHECK(sdp_stream_getline_view(&base, stream) == 0);
+	sdp_stream_close(stream);
+	stream = NULL;
+
+	/* parsing leaves the buffer as it is */
+	sb.len = len - 1;
+	CHECK((reference = mode_dump(buf, 0, 0)));
+	CHECK((session = sdp_parser_init(SDP_STREAM_TYPE_BUF, &sb)));
+	CHECK(sdp_session_parse(session, smpte2110_sdp_parse_specific, NULL) ==
+		SDP_PARSE_OK);
+	CHECK((dump = session_dump(session)));
+	CHECK(!strcmp(dump, reference));
+	CHECK(!memcmp(bounded, buf, len - 1));
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	if (stream)
+		sdp_stream_close(stream);
+	free(reference);
+	free(bounded);
+	free(dump);
+	free(buf);
+	return ret;
+}
+
+/* a backend serving lines out of an array of its own */
+struct lines_stream {
+	char **lines;
+	int next;
+	int opened;
+	int closed;
+};
+
+static int lines_open(void **stream_ctx, void *ctx)
+{
+	struct lines_stream *ls = (struct lines_stream*)ctx;
+
+	ls->next = 0;
+	ls->opened++;
+	*stream_ctx = ls;
+	return 0;
+}
 
+static int lines_close(void *stream_ctx)
+{
+	((struct lines_stream*)stream_ctx)->closed++;
 	return 0;
 }
 
+static ssize_t lines_getline_view(const char **line, void *stream_ctx)
+{
+	struct lines_stream *ls = (struct lines_stream*)stream_ctx;
+
+	if (!ls->lines[ls->next])
+		return 0;
+
+	*line = ls->lines[ls->next++];
+	return strlen(*line);
+}
+
+/* applications parse out of their own backends */
+static int test_stream_register(void)
+{
+	static char *lines[] = {
+		"v=0\n",
+		"o=- 1 1 IN IP4 127.0.0.1\n",
+		"s=custom\n",
+		"t=0 0\n",
+		"m=video 50000 RTP/AVP 96\n",
+		"c=IN IP4 239.0.0.1/32\n",
+		"a=mid:last",
+		NULL
+	};
+	static struct sdp_stream_ops incomplete = {
+		lines_open, lines_close, NULL
+	};
+	static struct sdp_stream_ops ops = {
+		lines_open, lines_close, lines_getline_view
+	};
+	struct lines_stream ls = { lines };
+	struct sdp_session *session = NULL;
+	sdp_stream_t stream = NULL;
+	const char *buf;
+	int type;
+	int ret = 0;
+
+	CHECK(sdp_stream_register(NULL) == -1);
+	CHECK(sdp_stream_register(&incomplete) == -1);
+	CHECK((type = sdp_stream_register(&ops)) >= SDP_STREAM_TYPE_CUSTOM);
+
+	/* optional functions are reported as not supported */
+	CHECK((stream = sdp_stream_open(type, &ls)));
+	CHECK(sdp_stream_peek(&buf, stream) == -1);
+	CHECK(sdp_stream_next(stream) == -1);
+	CHECK(sdp_stream_getline_view(&buf, stream) == 4 && buf == lines[0]);
+	CHECK(!sdp_stream_close(stream));
+	stream = NULL;
+	CHECK(ls.opened == 1 && ls.closed == 1);
+
+	CHECK((session = sdp_parser_init(type, &ls)));
+	CHECK(sdp_session_parse(session, NULL, NULL) == SDP_PARSE_OK);
+	CHECK(!strcmp(session->s, "custom"));
+	CHECK(sdp_media_get_mid(session, "last"));
+	sdp_parser_uninit(session);
+	session = NULL;
+	CHECK(ls.opened == 2 && ls.closed == 2);
+
+exit:
+	if (session)
+		sdp_parser_uninit(session);
+	if (stream)
+		sdp_stream_close(stream);
+	return ret;
+}
+
+/* datagrams are received in batches into a pool of buffers, parsed where
+ * they were received and the pool reused once they have all been read */
+#define USCK_BATCH 2
+#define USCK_BUF_SIZE 512
+#define USCK_DOCS 5
+
+static int test_usck(void)
+{
+	struct sdp_stream_usck usck = { -1, USCK_BATCH, USCK_BUF_SIZE };
+	struct sdp_stream_usck huge = { -1, 4, SIZE_MAX / 2 };
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	sdp_stream_t stream = NULL;
+	const char *pool = NULL;
+	char big[USCK_BUF_SIZE + 64];
+	int tx = -1;
+	int i;
+	int ret = 0;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	CHECK((usck.fd = socket(AF_INET, SOCK_DGRAM, 0)) != -1);
+	CHECK((tx = socket(AF_INET, SOCK_DGRAM, 0)) != -1);
+	CHECK(!bind(usck.fd, (struct sockaddr*)&addr, sizeof(addr)));
+	CHECK(!getsockname(usck.fd, (struct sockaddr*)&addr, &addrlen));
+
+	/* a pool whose size overflows is refused */
+	huge.fd = usck.fd;
+	CHECK(!sdp_stream_open(SDP_STREAM_TYPE_USCK, &huge));
+
+	/* more datagrams than the pool holds, with one too large for its
+	 * buffer to be dropped on the way */
+	memset(big, 'a', sizeof(big));
+	for (i = 0; i < USCK_DOCS; i++) {
+		char doc[128];
+		int len;
+
+		if (i == 2) {
+			CHECK(sendto(tx, big, sizeof(big), 0,
+				(struct sockaddr*)&addr, sizeof(addr)) ==
+				sizeof(big));
+		}
+
+		len = snprintf(doc, sizeof(doc), "v=0\n"
+			"o=- %d 1 IN IP4 127.0.0.1\n"
+			"s=datagram %d\n"
+			"t=0 0\n"
+			"m=video %d RTP/AVP 96\n"
+			"c=IN IP4 239.0.0.%d/32\n", i, i, 50000 + i, i + 1);
+		CHECK(sendto(tx, doc, len, 0, (struct sockaddr*)&addr,
+			sizeof(addr)) == len);
+	}
+
+	CHECK((stream = sdp_stream_open(SDP_STREAM_TYPE_USCK, &usck)));
+
+	for (i = 0; i < USCK_DOCS; i++) {
+		struct sdp_session *session;
+		struct sdp_media *media;
+		const char *buf;
+		char s[32];
+		int slot;
+
+		/* datagrams are queued up front, the n-th sent is received
+		 * into buffer n modulo the batch, the large one included */
+		slot = (i + (i >= 2)) % USCK_BATCH;
+
+		CHECK(sdp_stream_peek(&buf, stream) > 0);
+		if (!pool)
+			pool = buf - slot * USCK_BUF_SIZE;
+		CHECK(buf == pool + slot * USCK_BUF_SIZE);
+
+		CHECK((session = sdp_parser_init_stream(stream)));
+		if (sdp_session_parse(session, NULL, NULL) != SDP_PARSE_OK) {
+			sdp_parser_uninit(session);
+			CHECK(0);
+		}
+
+		snprintf(s, sizeof(s), "datagram %d", i);
+		media = sdp_media_get(session, SDP_MEDIA_TYPE_VIDEO);
+		if (!session->s || strcmp(session->s, s) || !media ||
+				media->m.port != 50000 + i) {
+			sdp_parser_uninit(session);
+			CHECK(0);
+		}
+
+		sdp_parser_uninit(session);
+		CHECK(!sdp_stream_next(stream));
+	}
+
+exit:
+	if (stream)
+		sdp_stream_close(stream);
+	if (tx != -1)
+		close(tx);
+	if (usck.fd != -1)
+		close(usck.fd);
+	return ret;
+}
+
+#define TAR_BLOCK 512
+
+static char *bundle_doc =
+	"v=0\n"
+	"o=- 1 1 IN IP4 127.0.0.1\n"
+	"s=%s\n"
+	"t=0 0\n"
+	"m=video 50000 RTP/AVP 96\n"
+	"c=IN IP4 239.0.0.1/32\n";
+
+/* a ustar member of len bytes, its header cut to hdr_len bytes if less than
+ * a block */
+static int tar_member(FILE *f, const char *name, char typeflag,
+		const char *data, size_t len, size_t hdr_len)
+{
+	unsigned char hdr[TAR_BLOCK] = { 0 };
+	static char pad[TAR_BLOCK];
+	unsigned int sum = 0;
+	int i;
+
+	snprintf((char*)hdr, 100, "%s", name);
+	snprintf((char*)hdr + 100, 8, "%07o", 0644);
+	snprintf((char*)hdr + 124, 12, "%011o", (unsigned int)len);
+	hdr[156] = typeflag;
+	memcpy(hdr + 257, "ustar\0" "00", 8);
+
+	/* the checksum is computed over blanks in its own field */
+	memset(hdr + 148, ' ', 8);
+	for (i = 0; i < TAR_BLOCK; i++)
+		sum += hdr[i];
+	snprintf((char*)hdr + 148, 8, "%06o", sum);
+
+	if (hdr_len < TAR_BLOCK)
+		return fwrite(hdr, 1, hdr_len, f) == hdr_len ? 0 : -1;
+
+	if (fwrite(hdr, 1, TAR_BLOCK, f) != TAR_BLOCK ||
+			fwrite(data, 1, len, f) != len) {
+		return -1;
+	}
+
+	len %= TAR_BLOCK;
+	return !len || fwrite(pad, 1, TAR_BLOCK - len, f) == TAR_BLOCK - len ?
+		0 : -1;
+}
+
+/* the bundle at path holds the documents named, in that order */
+static int bundle_check(const char *path, char **names, int count)
+{
+	sdp_stream_t stream = NULL;
+	int ret = 0;
+	int i = 0;
+
+	CHECK((stream = sdp_stream_open(SDP_STREAM_TYPE_BUNDLE,
+		(void*)path)));
+
+	do {
+		struct sdp_session *session;
+		int is_match;
+
+		CHECK(i < count);
+		CHECK((session = sdp_parser_init_stream(stream)));
+		is_match = sdp_session_parse(session, NULL, NULL) ==
+			SDP_PARSE_OK && session->s && !strcmp(session->s,
+			names[i]) && sdp_media_get(session,
+			SDP_MEDIA_TYPE_VIDEO);
+		sdp_parser_uninit(session);
+
+		if (!is_match)
+			printf("bundle document %d is not '%s'\n", i, names[i]);
+		CHECK(is_match);
+		i++;
+	} while (!sdp_stream_next(stream));
+
+	CHECK(i == count);
+
+exit:
+	if (stream)
+		sdp_stream_close(stream);
+	return ret;
+}
+
+/* writes a bundle of the (name, content) pairs of members and checks its
+ * documents. A tar archive ends with its last header cut to truncate bytes,
+ * or with zero blocks if truncate is a whole block */
+static int bundle_test(char **members, int count, int is_tar,
+		size_t truncate, char **names, int docs)
+{
+	char path[] = "/tmp/sdp_test_XXXXXX";
+	FILE *f = NULL;
+	int ret = 0;
+	int fd;
+	int i;
+
+	CHECK((fd = mkstemp(path)) != -1);
+	CHECK((f = fdopen(fd, "w")));
+
+	for (i = 0; i < count; i += 2) {
+		size_t len = strlen(members[i + 1]);
+
+		if (!is_tar) {
+			CHECK(fwrite(members[i + 1], 1, len, f) == len);
+			continue;
+		}
+
+		/* names ending with '/' are directories */
+		CHECK(!tar_member(f, members[i],
+			members[i][strlen(members[i]) - 1] == '/' ? '5' : '0',
+			members[i + 1], len, i + 2 < count ? TAR_BLOCK :
+			truncate));
+	}
+
+	/* end of archive */
+	if (is_tar && truncate == TAR_BLOCK) {
+		static char zero[2 * TAR_BLOCK];
+
+		CHECK(fwrite(zero, 1, sizeof(zero), f) == sizeof(zero));
+	}
+
+	CHECK(!fclose(f));
+	f = NULL;
+
+	ret = bundle_check(path, names, docs);
+
+exit:
+	if (f)
+		fclose(f);
+	unlink(path);
+	return ret;
+}
+
+static int test_bundle_tar(void)
+{
+	char one[256], two[256], three[256];
+	char both[512];
+	char *members[] = {
+		"a.sdp", both,
+		"dir/", "",
+		"dir/b.sdp", three,
+	};
+	char *names[] = { "one", "two", "three" };
+
+	snprintf(one, sizeof(one), bundle_doc, "one");
+	snprintf(two, sizeof(two), bundle_doc, "two");
+	snprintf(three, sizeof(three), bundle_doc, "three");
+	snprintf(both, sizeof(both), "%s%s", one, two);
+
+	/* members of several documents, directories skipped */
+	return bundle_test(members, 6, 1, TAR_BLOCK, names, 3);
+}
+
+static int test_bundle_split(void)
+{
+	char one[256], two[256];
+	char all[600];
+	char *members[] = { "all", all };
+	char *names[] = { "one", "two" };
+
+	/* a v= within a line does not start a document */
+	snprintf(one, sizeof(one), bundle_doc, "one");
+	snprintf(two, sizeof(two), bundle_doc, "two");
+	snprintf(all, sizeof(all), "\n%sa=tool:see v=0\n%s", one, two);
+
+	/* the blank line before the first document is skipped */
+	return bundle_test(members, 2, 0, 0, names, 2);
+}
+
+static int test_bundle_truncated(void)
+{
+	char one[256], two[256];
+	char *members[] = {
+		"a.sdp", one,
+		"b.sdp", two,
+	};
+	char *names[] = { "one" };
+	int ret = 0;
+
+	snprintf(one, sizeof(one), bundle_doc, "one");
+	snprintf(two, sizeof(two), bundle_doc, "two");
+
+	/* the archive ends within the header of the second member */
+	CHECK(!bundle_test(members, 4, 1, 100, names, 1));
+	/* and past the size field */
+	CHECK(!bundle_test(members, 4, 1, 200, names, 1));
+
+exit:
+	return ret;
+}
+
+static struct {
+	char *name;
+	int (*func)(void);
+} tests[] = {
+	{ "parse", test_parse },
+	{ "attribute names", test_attr_names },
+	{ "profile", test_profile },
+	{ "extractor session", test_extractor_session },
+	{ "watcher", test_watcher },
+	{ "load", test_load },
+	{ "parse batch", test_parse_batch },
+	{ "push chunks", test_push_chunks },
+	{ "push edges", test_push_edges },
+	{ "reset", test_reset },
+	{ "flat", test_flat },
+	{ "lazy", test_lazy },
+	{ "lazy error", test_lazy_error },
+	{ "source allowed", test_source_allowed },
+	{ "compact", test_compact },
+	{ "stream mmap", test_stream_mmap },
+	{ "stream buf", test_stream_buf },
+	{ "stream register", test_stream_register },
+	{ "usck", test_usck },
+	{ "sap", test_sap },
+	{ "bundle tar", test_bundle_tar },
+	{ "bundle split", test_bundle_split },
+	{ "bundle truncated", test_bundle_truncated },
+};
+
+int main(int argc, char **argv)
+{
+	int failures = 0;
+	int i;
+
+	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		int ret = tests[i].func();
+
+		printf("%s: %s\n", tests[i].name, ret ? "failed" : "ok");
+		if (ret)
+			failures++;
+	}
+
+	printf("test result: %d of %d failed\n", failures,
+		(int)(sizeof(tests) / sizeof(tests[0])));
+
+	return failures ? -1 : 0;
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "smpte2110_sdp_parser.h"
+
+/* Scaling benchmark
+ * Descriptions of 10 to 10,000 media sections are generated, parsed and
+ * walked media by media the way the extractor does. The time per media
+ * section is expected to stay flat as the description grows: the test
+ * fails if the largest description costs more than SLOPE_MAX times as
+ * much per media section as the smallest one measured.
+ *
+ *   make check */
+
+#define MEDIA_MIN 10
+#define MEDIA_MAX 10000
+#define MEDIA_PER_RUN 50000 /* parsed per measurement, at every size */
+#define RUNS 3 /* the fastest is kept */
+#define SLOPE_MAX 3.0
+
+static char *sdp_generate(int n)
+{
+	static char *header =
+		"v=0\n"
+		"o=- 123456 11 IN IP4 192.168.100.2\n"
+		"s=Scaling benchmark\n"
+		"t=0 0\n"
+		"a=recvonly\n";
+	static char *media =
+		"m=video %d RTP/AVP 112\n"
+		"c=IN IP4 239.100.%d.%d/32\n"
+		"a=source-filter:incl IN IP4 239.100.%d.%d 192.168.100.2\n"
+		"a=rtpmap:112 raw/90000\n"
+		"a=fmtp:112 sampling=YCbCr-4:2:2; width=1920; height=1080; "
+			"exactframerate=50; depth=10; TCS=SDR; "
+			"colorimetry=BT709; PM=2110GPM; TP=2110TPN; "
+			"SSN=ST2110-20:2017; \n"
+		"a=mid:m%d\n";
+	size_t size = strlen(header) + (size_t)n * (strlen(media) + 64) + 1;
+	char *sdp;
+	size_t len;
+	int i;
+
+	if (!(sdp = (char*)malloc(size)))
+		return NULL;
+
+	len = snprintf(sdp, size, "%s", header);
+	for (i = 0; i < n; i++) {
+		len += snprintf(sdp + len, size - len, media, 50000 + 2 * i,
+			i >> 8, i & 0xff, i >> 8, i & 0xff, i);
+	}
+
+	return sdp;
+}
+
+/* parses the description and visits every media section, returns the
+ * number visited or -1 */
+static int parse_walk(char *sdp, int is_lazy, int is_parallel)
+{
+	struct sdp_session *session;
+	struct sdp_media *media;
+	char mid[16];
+	int i = -1;
+
+	if (!(session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, sdp)))
+		return -1;
+
+	session->is_lazy = is_lazy;
+	session->is_parallel = is_parallel;
+	if (sdp_session_parse(session, smpte2110_sdp_parse_specific, NULL) !=
+			SDP_PARSE_OK) {
+		goto exit;
+	}
+
+	for (media = sdp_media_get(session, SDP_MEDIA_TYPE_VIDEO), i = 0;
+			media; media = sdp_media_get_next(media), i++) {
+		if (!sdp_media_attr_get(media, SDP_ATTR_FMTP) ||
+				!sdp_media_attr_get(media,
+				SDP_ATTR_SOURCE_FILTER)) {
+			i = -1;
+			break;
+		}
+
+		snprintf(mid, sizeof(mid), "m%d", i);
+		if (sdp_media_get_mid(session, mid) != media) {
+			i = -1;
+			break;
+		}
+	}
+
+exit:
+	sdp_parser_uninit(session);
+	return i;
+}
+
+/* nanoseconds per media section, 0 on failure */
+static double measure(char *sdp, int n, int is_lazy, int is_parallel)
+{
+	double best = 0;
+	int reps = MEDIA_PER_RUN / n;
+	int run;
+	int i;
+
+	for (run = 0; run < RUNS; run++) {
+		struct timespec start, end;
+		double ns;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < reps; i++) {
+			if (parse_walk(sdp, is_lazy, is_parallel) != n)
+				return 0;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		ns = ((end.tv_sec - start.tv_sec) * 1e9 +
+			(end.tv_nsec - start.tv_nsec)) / ((double)reps * n);
+		if (!run || ns < best)
+			best = ns;
+	}
+
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	static char *modes[] = { "eager", "lazy", "parallel" };
+	double first[3] = { 0 };
+	double last[3] = { 0 };
+	int failures = 0;
+	int mode;
+	int n;
+
+	printf("%-10s", "media");
+	for (mode = 0; mode < 3; mode++)
+		printf("%14s", modes[mode]);
+	printf("   (ns per media section)\n");
+
+	for (n = MEDIA_MIN; n <= MEDIA_MAX; n *= 10) {
+		char *sdp;
+
+		if (!(sdp = sdp_generate(n))) {
+			printf("failed to generate %d media sections\n", n);
+			return -1;
+		}
+
+		printf("%-10d", n);
+		for (mode = 0; mode < 3; mode++) {
+			double ns = measure(sdp, n, mode == 1, mode == 2);
+
+			if (!ns) {
+				printf("\nfailed to parse %d media sections "
+					"(%s)\n", n, modes[mode]);
+				free(sdp);
+				return -1;
+			}
+
+			if (!first[mode])
+				first[mode] = ns;
+			last[mode] = ns;
+			printf("%14.1f", ns);
+		}
+		printf("\n");
+		free(sdp);
+	}
+
+	for (mode = 0; mode < 3; mode++) {
+		double slope = last[mode] / first[mode];
+
+		printf("%s: x%.2f per media section from %d to %d\n",
+			modes[mode], slope, MEDIA_MIN, MEDIA_MAX);
+		if (SLOPE_MAX < slope)
+			failures++;
+	}
+
+	printf("scaling result: %s\n", failures ? "superlinear" : "linear");
+
+	return failures ? -1 : 0;
+}
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sdp_scan.h"
+#include "smpte2110_sdp_parser.h"
+
+/* Tokenizer benchmark
+ * A generated description is split into lines and their fields on spaces,
+ * once by the scanner, a block at a time as the parser does, and once the
+ * way lines were tokenized before it: found with memchr(), copied out and
+ * split with strtok_r(). Both must find the same tokens, and the
+ * throughput of each is reported, as is that of the whole parser over the
+ * same description. It depends on the optimization level the library is
+ * built with, -O0 by default, strtok_r() being that of the C library.
+ *
+ *   make check */
+
+#define DOC_SIZE (16 << 20)
+#define BLOCK 65536 /* as SDP_PARSE_BLOCK */
+#define RUNS 5 /* the fastest is kept */
+
+static char *media =
+	"m=video 50020 RTP/AVP 98\r\n"
+	"c=IN IP4 239.20.186.1/32\r\n"
+	"a=source-filter: incl IN IP4 239.20.186.1 192.168.30.202\r\n"
+	"a=rtpmap:98 raw/90000\r\n"
+	"a=fmtp:98 sampling=YCbCr-4:2:2; width=1920; height=1080; "
+		"interlace; exactframerate=30000/1001; depth=10; TCS=SDR; "
+		"colorimetry=BT709; PM=2110GPM; SSN=ST2110-20:2017; "
+		"TP=2110TPN; \r\n"
+	"a=ts-refclk:ptp=IEEE1588-2008::42\r\n"
+	"a=mediaclk:direct=0\r\n"
+	"a=mid:primary\r\n";
+
+struct result {
+	size_t tokens;
+	size_t sum; /* of the token lengths and positions */
+};
+
+static size_t line_trim(const char *line, size_t len)
+{
+	while (len && (line[len - 1] == ' ' || line[len - 1] == '\t' ||
+			line[len - 1] == '\r' || line[len - 1] == '\n')) {
+		len--;
+	}
+
+	return len;
+}
+
+static void tokenize_strtok(const char *doc, size_t len, struct result *r)
+{
+	const char *end = doc + len;
+	const char *line;
+	const char *next;
+	char buf[1024];
+
+	for (line = doc; line < end; line = next) {
+		char *saveptr;
+		char *token;
+		size_t n;
+
+		next = (const char*)memchr(line, '\n', end - line);
+		next = next ? next + 1 : end;
+
+		n = line_trim(line, next - line);
+		memcpy(buf, line, n);
+		buf[n] = 0;
+
+		for (token = strtok_r(buf, " ", &saveptr); token;
+				token = strtok_r(NULL, " ", &saveptr)) {
+			r->tokens++;
+			r->sum += strlen(token) + (token - buf);
+		}
+	}
+}
+
+static void tokenize_scan(const char *doc, size_t len, struct result *r)
+{
+	struct sdp_scan scan;
+	uint64_t *bits;
+	char *buf;
+	size_t partial = 0;
+	size_t offset;
+
+	buf = (char*)malloc(2 * BLOCK + 1 + SDP_SCAN_PAD);
+	bits = (uint64_t*)malloc(SDP_SCAN_WORDS(2 * BLOCK) * sizeof(uint64_t));
+	if (!buf || !bits)
+		goto exit;
+
+	for (offset = 0; offset < len; ) {
+		size_t block = len - offset < BLOCK ? len - offset : BLOCK;
+		int is_last = offset + block == len;
+		char *line;
+		char *eol;
+		char *end;
+
+		memcpy(buf + partial, doc + offset, block);
+		end = buf + partial + block;
+		*end = 0;
+		offset += block;
+		sdp_scan_index(&scan, buf, end - buf, bits);
+
+		for (line = buf; line < end; line = eol + 1) {
+			char *token;
+
+			eol = sdp_scan_eol(&scan, line);
+			if (eol == end && !is_last)
+				break;
+
+			line[line_trim(line, eol - line)] = 0;
+			sdp_scan_line(&scan, line);
+			for (token = sdp_scan_token(&scan, line, " "); token;
+					token = sdp_scan_token(&scan, NULL,
+					" ")) {
+				r->tokens++;
+				r->sum += scan.len + (token - line);
+			}
+		}
+
+		partial = line < end ? end - line : 0;
+		memmove(buf, line, partial);
+	}
+
+exit:
+	free(buf);
+	free(bits);
+}
+
+/* the whole parse, of which tokenizing is a part */
+static void parse(const char *doc, size_t len, struct result *r)
+{
+	struct sdp_session *session;
+
+	if (!(session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, (void*)doc)))
+		return;
+
+	if (sdp_session_parse(session, smpte2110_sdp_parse_specific,
+			NULL) == SDP_PARSE_OK) {
+		r->tokens = session->media_count;
+	}
+
+	sdp_parser_uninit(session);
+}
+
+static double measure(void (*tokenize)(const char*, size_t,
+		struct result*), const char *doc, size_t len, struct result *r)
+{
+	double best = 0;
+	int run;
+
+	for (run = 0; run < RUNS; run++) {
+		struct timespec start, end;
+		double s;
+
+		memset(r, 0, sizeof(struct result));
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		tokenize(doc, len, r);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		s = (end.tv_sec - start.tv_sec) +
+			(end.tv_nsec - start.tv_nsec) / 1e9;
+		if (!run || s < best)
+			best = s;
+	}
+
+	return len / best / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	struct result baseline;
+	struct result scan;
+	struct result parsed;
+	size_t media_len = strlen(media);
+	size_t len = 0;
+	double gbps[3];
+	char *doc;
+
+	if (!(doc = (char*)malloc(DOC_SIZE + 1))) {
+		printf("failed to allocate the description\n");
+		return -1;
+	}
+
+	len = snprintf(doc, DOC_SIZE, "v=0\r\no=- 1 1 IN IP4 127.0.0.1\r\n"
+		"s=Tokenizer benchmark\r\nt=0 0\r\n");
+	for ( ; len + media_len <= DOC_SIZE; len += media_len)
+		memcpy(doc + len, media, media_len);
+	doc[len] = 0;
+
+	gbps[0] = measure(tokenize_strtok, doc, len, &baseline);
+	gbps[1] = measure(tokenize_scan, doc, len, &scan);
+	gbps[2] = measure(parse, doc, len, &parsed);
+	free(doc);
+
+	printf("strtok_r: %.3f GB/s, %zu tokens\n", gbps[0], baseline.tokens);
+	printf("scanner: %.3f GB/s, %zu tokens\n", gbps[1], scan.tokens);
+	printf("parser: %.3f GB/s, %zu media\n", gbps[2], parsed.tokens);
+
+	if (baseline.tokens != scan.tokens || baseline.sum != scan.sum) {
+		printf("scan result: tokens differ\n");
+		return -1;
+	}
+
+	printf("scan result: x%.2f\n", gbps[1] / gbps[0]);
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "smpte2110_sdp_parser.h"
+
+/* Concurrency stress test
+ * Threads parse the same description over and over, each into sessions of
+ * its own, with a specific parser counting its calls in a per-thread
+ * context. Every parse is checked against a reference parsed beforehand on
+ * a single thread.
+ *
+ *   make check */
+
+#define THREADS 16
+#define ITERATIONS 2000
+
+static char *sdp =
+	"v=0\n"
+	"o=- 123456 11 IN IP4 192.168.100.2\n"
+	"s=Example of a SMPTE ST2110-20 signal\n"
+	"t=0 0\n"
+	"a=recvonly\n"
+	"a=group:DUP primary secondary\n"
+	"m=video 50000 RTP/AVP 112\n"
+	"c=IN IP4 239.100.9.10/32\n"
+	"a=source-filter:incl IN IP4 239.100.9.10 192.168.100.2 "
+		"192.168.100.3\n"
+	"a=rtpmap:112 raw/90000\n"
+	"a=fmtp:112 sampling=YCbCr-4:2:2; width=1280; height=720; "
+		"exactframerate=60000/1001; depth=10; TCS=SDR; "
+		"colorimetry=BT709; PM=2110GPM; TP=2110TPN; "
+		"SSN=ST2110-20:2017; \n"
+	"a=mid:primary\n"
+	"m=video 50020 RTP/AVP 112\n"
+	"c=IN IP4 239.101.9.10/32\n"
+	"a=source-filter:incl IN IP4 239.101.9.10 192.168.101.2\n"
+	"a=rtpmap:112 raw/90000\n"
+	"a=fmtp:112 sampling=YCbCr-4:2:2; width=1920; height=1080; "
+		"exactframerate=50; depth=10; TCS=SDR; "
+		"colorimetry=BT709; PM=2110GPM; TP=2110TPN; "
+		"SSN=ST2110-20:2017; \n"
+	"a=mid:secondary\n";
+
+struct summary {
+	enum sdp_parse_err err;
+	int calls; /* of the specific parser */
+	int width[2];
+	int height[2];
+	int src_list_len[2];
+	unsigned short port[2];
+	char mid[2][16];
+};
+
+struct thread_ctx {
+	int is_lazy;
+	int calls;
+	int failures;
+	struct summary *reference;
+};
+
+static enum sdp_parse_err parse_specific_counted(struct sdp_session *session,
+		struct sdp_media *media, struct sdp_attr *a, char *attr,
+		char *value, char *params, void *ctx)
+{
+	((struct thread_ctx*)ctx)->calls++;
+
+	return smpte2110_sdp_parse_specific(session, media, a, attr, value,
+		params, NULL);
+}
+
+static void summarize(struct thread_ctx *ctx, struct summary *s)
+{
+	struct sdp_session *session;
+	struct sdp_media *media;
+	int i;
+
+	memset(s, 0, sizeof(struct summary));
+	ctx->calls = 0;
+
+	if (!(session = sdp_parser_init(SDP_STREAM_TYPE_CHAR, sdp))) {
+		s->err = SDP_PARSE_ERROR;
+		return;
+	}
+
+	session->is_lazy = ctx->is_lazy;
+	s->err = sdp_session_parse(session, parse_specific_counted, ctx);
+	if (s->err != SDP_PARSE_OK)
+		goto exit;
+
+	for (media = sdp_media_get(session, SDP_MEDIA_TYPE_VIDEO), i = 0;
+			media && i < 2; media = sdp_media_get_next(media), i++) {
+		struct sdp_attr *a;
+
+		s->port[i] = media->m.port;
+
+		a = sdp_media_attr_get(media, SDP_ATTR_FMTP);
+		if (a && a->type == SDP_ATTR_FMTP) {
+			struct smpte2110_media_attr_fmtp *fmtp =
+				(struct smpte2110_media_attr_fmtp*)
+				a->value.fmtp.params;
+
+			s->width[i] = fmtp->params.width;
+			s->height[i] = fmtp->params.height;
+		}
+
+		a = sdp_media_attr_get(media, SDP_ATTR_SOURCE_FILTER);
+		if (a && a->type == SDP_ATTR_SOURCE_FILTER) {
+			s->src_list_len[i] =
+				a->value.source_filter.spec.src_list_len;
+		}
+
+		a = sdp_media_attr_get(media, SDP_ATTR_MID);
+		if (a && a->type == SDP_ATTR_MID) {
+			snprintf(s->mid[i], sizeof(s->mid[i]), "%s",
+				a->value.mid.identification_tag);
+		}
+	}
+
+exit:
+	/* lazy sessions call the specific parser as attributes are read */
+	s->calls = ctx->calls;
+	sdp_parser_uninit(session);
+}
+
+static void *stress(void *arg)
+{
+	struct thread_ctx *ctx = (struct thread_ctx*)arg;
+	struct summary s;
+	int i;
+
+	for (i = 0; i < ITERATIONS; i++) {
+		summarize(ctx, &s);
+		if (memcmp(&s, ctx->reference, sizeof(struct summary)))
+			ctx->failures++;
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	struct summary reference[2];
+	struct thread_ctx ctx[THREADS];
+	pthread_t threads[THREADS];
+	int failures = 0;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		struct thread_ctx ref_ctx = { i, 0, 0, NULL };
+
+		summarize(&ref_ctx, &reference[i]);
+		if (reference[i].err != SDP_PARSE_OK) {
+			printf("failed to parse the reference description\n");
+			return -1;
+		}
+	}
+
+	for (i = 0; i < THREADS; i++) {
+		ctx[i].is_lazy = i & 1;
+		ctx[i].calls = 0;
+		ctx[i].failures = 0;
+		ctx[i].reference = &reference[i & 1];
+
+		if (pthread_create(&threads[i], NULL, stress, &ctx[i])) {
+			printf("failed to create thread %d\n", i);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < THREADS; i++) {
+		pthread_join(threads[i], NULL);
+		failures += ctx[i].failures;
+	}
+
+	printf("stress result: %d of %d parses mismatched\n", failures,
+		THREADS * ITERATIONS);
+
+	return failures ? -1 : 0;
+}